@@ -0,0 +1,170 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <fstream>
+#include <iostream>
+#include <print>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include "batch_runner.hpp"
+#include "config.hpp"
+
+namespace po = boost::program_options;
+
+
+/**
+ * Read image paths from a list file, one per line. Empty lines and lines starting
+ * with '#' are skipped.
+ * @param path path to list file
+ * @param images vector to add image paths to
+ * @return false if the file could not be read
+ */
+static bool read_image_list(const std::filesystem::path& path, std::vector<std::filesystem::path>& images)
+{
+    std::ifstream in(path);
+    if (! in) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (! line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (! line.empty() && line[0] != '#') {
+            images.emplace_back(line);
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::filesystem::path config_path{"auric.yaml"};
+    std::filesystem::path list_path;
+    std::filesystem::path output_path{"batch"};
+    std::vector<std::filesystem::path> images;
+    uint32_t seconds{30};
+    unsigned threads{0};
+    bool fast_load{false};
+    bool fast_disk{false};
+    bool verbose{false};
+
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("config,c", po::value<std::filesystem::path>(&config_path), "configuration file (default: auric.yaml)")
+            ("list,l", po::value<std::filesystem::path>(&list_path), "file with one image path per line")
+            ("output,o", po::value<std::filesystem::path>(&output_path), "directory for screenshots and results (default: batch)")
+            ("seconds,s", po::value<uint32_t>(&seconds), "emulated seconds to run each image after boot (default: 30)")
+            ("threads,j", po::value<unsigned>(&threads), "worker threads (default: one per core)")
+            ("fast-load", po::bool_switch(&fast_load), "load tapes instantly via ROM routines")
+            ("fast-disk", po::bool_switch(&fast_disk), "transfer disk sectors without waiting for each byte")
+            ("verbose,v", po::bool_switch(&verbose), "show emulator log output")
+            ("image", po::value<std::vector<std::filesystem::path>>(&images), ".tap, .wav or .dsk image to run");
+
+        po::positional_options_description positional;
+        positional.add("image", -1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help")) {
+            std::println("Usage: auric_batch [options] [images...]\n");
+            desc.print(std::cout);
+            return 0;
+        }
+    }
+    catch (const std::exception& err) {
+        std::println("Argument error: {}", err.what());
+        return 1;
+    }
+
+    if (! list_path.empty() && ! read_image_list(list_path, images)) {
+        std::println("Could not read image list {}", list_path.string());
+        return 1;
+    }
+
+    if (images.empty()) {
+        std::println("No images given");
+        return 1;
+    }
+
+    // Each machine logs its setup, which is only noise with many machines running.
+    boost::log::core::get()->set_filter(boost::log::trivial::severity >= (verbose ? boost::log::trivial::info
+                                                                                  : boost::log::trivial::warning));
+
+    Config config;
+    try {
+        if (! config.read_config_file(config_path)) {
+            return 2;
+        }
+    }
+    catch (const std::exception& err) {
+        std::println("Error reading config file: {}", err.what());
+        return 2;
+    }
+    if (fast_load) {
+        config.set_tape_fast_load(true);
+    }
+    if (fast_disk) {
+        config.set_disk_fast_transfer(true);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(output_path, ec);
+    if (ec) {
+        std::println("Could not create output directory {}: {}", output_path.string(), ec.message());
+        return 2;
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto start_tp = clock::now();
+
+    BatchRunner runner(config, output_path, seconds);
+    auto results = runner.run(images, threads);
+
+    const double wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start_tp).count();
+    uint64_t total_frames = 0;
+    size_t failed = 0;
+    for (const auto& result : results) {
+        total_frames += result.boot_frames + result.frames;
+        failed += result.ok ? 0 : 1;
+    }
+
+    auto results_path = output_path / "results.csv";
+    try {
+        BatchRunner::save_results(results, results_path);
+    }
+    catch (const std::exception& err) {
+        std::println("{}", err.what());
+        return 2;
+    }
+
+    std::println("Ran {} images ({} failed) in {:.1f} s, {} frames, {:.1f}x real time in total",
+                 results.size(), failed, wall_ms / 1000.0, total_frames, total_frames * 20.0 / wall_ms);
+    std::println("Results written to {}", results_path.string());
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <print>
+#include <thread>
+
+#include "batch_runner.hpp"
+#include "machine.hpp"
+
+using namespace std::chrono_literals;
+
+constexpr uint32_t frames_per_second = 50;
+constexpr uint32_t cycles_per_frame = 19968;
+constexpr uint32_t key_hold_frames = 3;
+constexpr uint32_t key_release_frames = 3;
+
+// Keys in the keyboard matrix, as row * 8 + column.
+constexpr uint8_t key_shift = 36;
+constexpr uint8_t key_return = 61;
+constexpr uint8_t key_space = 32;
+constexpr uint8_t key_apostrophe = 31;
+
+// Letters A-Z and digits 0-9.
+constexpr uint8_t letter_keys[26] = {53, 18, 23, 15, 51, 11, 50, 49, 41, 8, 24, 57, 16,
+                                     1, 42, 43, 14, 10, 54, 9, 40, 3, 55, 6, 48, 21};
+constexpr uint8_t digit_keys[10] = {58, 5, 22, 7, 19, 2, 17, 0, 56, 25};
+
+
+double BatchResult::speed() const
+{
+    return wall_ms > 0 ? (boot_frames + frames) * 20.0 / wall_ms : 0.0;
+}
+
+
+BatchRunner::BatchRunner(const Config& config, std::filesystem::path output_path, uint32_t seconds) :
+    config(config),
+    output_path(std::move(output_path)),
+    seconds(seconds)
+{
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<std::filesystem::path>& images, unsigned threads) const
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<unsigned>(threads, images.size());
+
+    std::vector<BatchResult> results(images.size());
+    std::atomic<size_t> next_image{0};
+    std::atomic<size_t> done_count{0};
+    std::mutex print_mutex;
+
+    // Each worker takes the next title when it is done with its current one.
+    auto worker = [&] {
+        for (size_t i = next_image++; i < images.size(); i = next_image++) {
+            results[i] = run_title(images[i], i);
+
+            std::lock_guard lock(print_mutex);
+            const auto& result = results[i];
+            std::println("[{}/{}] {}: {} ({} + {} frames, {:.0f} ms, {:.1f}x)", ++done_count, images.size(),
+                         result.image.string(), result.ok ? std::format("{:016x}", result.state_hash) : result.error,
+                         result.boot_frames, result.frames, result.wall_ms, result.speed());
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    workers.clear();    // Joins all workers.
+
+    return results;
+}
+
+BatchResult BatchRunner::run_title(const std::filesystem::path& image, size_t index) const
+{
+    using clock = std::chrono::steady_clock;
+    auto start_tp = clock::now();
+
+    BatchResult result{image, false, "", 0, 0, 0, 0.0, {}};
+
+    auto extension = image.extension().string();
+    std::ranges::transform(extension, extension.begin(), ::tolower);
+    const bool is_disk = extension == ".dsk";
+
+    try {
+        if (! std::filesystem::is_regular_file(image)) {
+            throw std::runtime_error("image not found");
+        }
+
+        Config title_config = config;
+        title_config.set_tape_path(is_disk ? "" : image);
+        title_config.set_disk_path(is_disk ? image : "");
+
+        Machine machine(title_config);
+        machine.init();
+        machine.load_roms();
+        machine.reset_cpu();
+
+        if (! machine.run_boot(title_config.boot_frames())) {
+            throw std::runtime_error("stopped at break during boot");
+        }
+        const uint64_t boot_cycles = machine.total_cycles;
+        result.boot_frames = boot_cycles / cycles_per_frame;
+
+        if (! is_disk && ! type_text(machine, "CLOAD\"\"\n")) {
+            throw std::runtime_error("stopped at break while typing");
+        }
+
+        if (! machine.run_frames(seconds * frames_per_second)) {
+            throw std::runtime_error("stopped at break");
+        }
+        result.frames = (machine.total_cycles - boot_cycles) / cycles_per_frame;
+        result.state_hash = machine.state_hash();
+
+        // Images from different directories may share a name, the index keeps them apart.
+        result.screenshot = output_path / std::format("{:04}-{}.ppm", index, image.filename().string());
+        save_screenshot(machine, result.screenshot);
+        result.ok = true;
+    }
+    catch (const std::exception& err) {
+        result.error = err.what();
+    }
+
+    result.wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start_tp).count();
+    return result;
+}
+
+bool BatchRunner::type_text(Machine& machine, std::string_view text)
+{
+    for (char c : text) {
+        uint8_t key;
+        bool shift = false;
+
+        if (c >= 'A' && c <= 'Z') {
+            key = letter_keys[c - 'A'];
+        }
+        else if (c >= 'a' && c <= 'z') {
+            key = letter_keys[c - 'a'];
+        }
+        else if (c >= '0' && c <= '9') {
+            key = digit_keys[c - '0'];
+        }
+        else if (c == ' ') {
+            key = key_space;
+        }
+        else if (c == '"') {
+            key = key_apostrophe;
+            shift = true;
+        }
+        else if (c == '\n') {
+            key = key_return;
+        }
+        else {
+            throw std::runtime_error(std::format("can not type '{}'", c));
+        }
+
+        if (shift) {
+            machine.key_press(key_shift, true);
+        }
+        machine.key_press(key, true);
+        if (! machine.run_frames(key_hold_frames)) {
+            return false;
+        }
+
+        machine.key_press(key, false);
+        if (shift) {
+            machine.key_press(key_shift, false);
+        }
+        if (! machine.run_frames(key_release_frames)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BatchRunner::save_screenshot(const Machine& machine, const std::filesystem::path& path)
+{
+    const auto& pixels = machine.get_ula().get_pixels();
+
+    std::ofstream out(path, std::ios::binary);
+    if (! out) {
+        throw std::runtime_error(std::format("could not write screenshot {}", path.string()));
+    }
+
+    out << std::format("P6\n{} {}\n255\n", Frontend::texture_width, Frontend::texture_height);
+
+    // Pixels are stored as BGRA.
+    std::vector<uint8_t> rgb(pixels.size() / Frontend::texture_bpp * 3);
+    for (size_t src = 0, dst = 0; src < pixels.size(); src += Frontend::texture_bpp, dst += 3) {
+        rgb[dst] = pixels[src + 2];
+        rgb[dst + 1] = pixels[src + 1];
+        rgb[dst + 2] = pixels[src];
+    }
+    out.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+
+    if (! out) {
+        throw std::runtime_error(std::format("could not write screenshot {}", path.string()));
+    }
+}
+
+void BatchRunner::save_results(const std::vector<BatchResult>& results, const std::filesystem::path& path)
+{
+    std::ofstream out(path);
+    if (! out) {
+        throw std::runtime_error(std::format("could not write {}", path.string()));
+    }
+
+    out << "image,status,boot_frames,frames,state_hash,wall_ms,speed,screenshot\n";
+    for (const auto& result : results) {
+        out << std::format("\"{}\",\"{}\",{},{},{:016x},{:.1f},{:.2f},\"{}\"\n",
+                           result.image.string(), result.ok ? "ok" : result.error, result.boot_frames, result.frames,
+                           result.state_hash, result.wall_ms, result.speed(), result.screenshot.string());
+    }
+}
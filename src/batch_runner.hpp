@@ -0,0 +1,122 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "config.hpp"
+
+class Machine;
+
+
+/**
+ * Result of running one tape or disk image.
+ */
+struct BatchResult
+{
+    std::filesystem::path image;
+    bool ok;
+    std::string error;
+    uint32_t boot_frames;       // Emulated frames to boot.
+    uint32_t frames;            // Emulated frames after boot.
+    uint64_t state_hash;        // Machine state hash after the last frame.
+    double wall_ms;             // Wall clock time for the whole title.
+    std::filesystem::path screenshot;
+
+    /**
+     * Get emulation speed relative to real time, including boot.
+     * @return emulated time divided by wall clock time
+     */
+    double speed() const;
+};
+
+
+/**
+ * Runs many tape and disk images, each in its own headless Machine, spread over a pool
+ * of worker threads. Each title is booted, tapes are started by typing CLOAD"", and the
+ * machine then runs for a given emulated time. A screenshot of the final frame is saved
+ * and the machine state hash is recorded, for comparing runs of a large corpus.
+ *
+ * Titles are taken from a shared queue by the first idle worker, so long and short titles
+ * even out across the workers.
+ */
+class BatchRunner
+{
+public:
+    /**
+     * Constructor.
+     * @param config base configuration, the image path is set per title
+     * @param output_path directory to write screenshots to
+     * @param seconds emulated seconds to run each title after boot
+     */
+    BatchRunner(const Config& config, std::filesystem::path output_path, uint32_t seconds);
+
+    /**
+     * Run all images.
+     * @param images paths to .tap and .dsk images
+     * @param threads number of worker threads, 0 for one per core
+     * @return results, in the same order as images
+     */
+    std::vector<BatchResult> run(const std::vector<std::filesystem::path>& images, unsigned threads) const;
+
+    /**
+     * Run one image. Errors are returned in the result, never thrown.
+     * @param image path to .tap or .dsk image
+     * @param index index of image in the run, to give each screenshot its own name
+     * @return result
+     */
+    BatchResult run_title(const std::filesystem::path& image, size_t index) const;
+
+    /**
+     * Type text on the keyboard, holding each key for a few frames.
+     * Supports letters, digits, space, '"' and '\n' for Return.
+     * @param machine machine to type on
+     * @param text text to type
+     * @return false if execution stopped at a break
+     * @throws std::runtime_error if text has a character that can not be typed
+     */
+    static bool type_text(Machine& machine, std::string_view text);
+
+    /**
+     * Write the current screen of machine as a binary PPM image.
+     * @param machine machine to take screenshot of
+     * @param path path of file to write
+     * @throws std::runtime_error if the file could not be written
+     */
+    static void save_screenshot(const Machine& machine, const std::filesystem::path& path);
+
+    /**
+     * Write results as CSV.
+     * @param results results to write
+     * @param path path of file to write
+     * @throws std::runtime_error if the file could not be written
+     */
+    static void save_results(const std::vector<BatchResult>& results, const std::filesystem::path& path);
+
+private:
+    const Config& config;
+    std::filesystem::path output_path;
+    uint32_t seconds;
+};
+
+#endif // BATCH_RUNNER_H
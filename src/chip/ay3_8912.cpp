@@ -15,6 +15,7 @@
 //   along with this program.  If not, see <http://www.gnu.org/licenses/>
 // =========================================================================
 
+#include <hash.hpp>
 #include <machine.hpp>
 
 #include "ay3_8912.hpp"
@@ -70,7 +71,7 @@
 using namespace std;
 
 // Volume table from Oricutron.
-uint32_t voltab[] = {0, 513/4, 828/4, 1239/4, 1923/4, 3238/4, 4926/4, 9110/4, 10344/4, 17876/4, 24682/4, 30442/4, 38844/4, 47270/4, 56402/4, 65535/4};
+constexpr uint32_t voltab[] = {0, 513/4, 828/4, 1239/4, 1923/4, 3238/4, 4926/4, 9110/4, 10344/4, 17876/4, 24682/4, 30442/4, 38844/4, 47270/4, 56402/4, 65535/4};
 
 constexpr uint8_t cycle_shift = 12;
 constexpr uint32_t cycles_per_second = 998400;
@@ -214,35 +215,7 @@ void AY3_8912::SoundState::print_status()
     noise.print_status();
 }
 
-void AY3_8912::SoundState::write_register_change(uint8_t value)
-{
-    if (changes.update_log_cycle) {
-        changes.log_cycle = changes.new_log_cycle;
-        changes.update_log_cycle = false;
-    }
-
-    changes.buffer.push_back({changes.log_cycle, current_register, value});
-}
-
-void AY3_8912::SoundState::trim_register_changes()
-{
-    // Change change cycles to be relative to local counting.
-    for (auto& rc : changes.buffer) {
-        if (rc.cycle > last_cycle)
-            rc.cycle -= last_cycle;
-        else
-            rc.cycle = 0;
-    }
-
-    if (changes.buffer.size() > 200) {
-        for (auto& rc : changes.buffer) {
-            exec_register_change(rc);
-        }
-        changes.buffer.clear();
-    }
-}
-
-void AY3_8912::SoundState::exec_register_change(RegisterChange& change)
+void AY3_8912::SoundState::exec_register_change(const RegisterChange& change)
 {
     switch (change.register_index) {
         case CH_A_PERIOD_LOW:
@@ -372,12 +345,14 @@ void AY3_8912::SoundState::exec_audio(uint32_t cycle)
 
 AY3_8912::AY3_8912(Machine& machine) :
     machine(machine),
-    m_read_data_handler(nullptr)
+    m_read_data_handler(nullptr),
+    audio_frames_played(0)
 {}
 
 void AY3_8912::reset()
 {
     state.reset();
+    changes.reset();
 }
 
 void AY3_8912::print_status()
@@ -385,19 +360,81 @@ void AY3_8912::print_status()
     state.print_status();
 }
 
-void AY3_8912::save_to_snapshot(Snapshot& snapshot)
+uint64_t AY3_8912::state_hash() const
+{
+    uint64_t hash = fnv1a_64_values(fnv1a_64_offset, state.bdir, state.bc1, state.bc2, state.current_register);
+    return fnv1a_64(state.registers, hash);
+}
+
+void AY3_8912::save_to_snapshot(Snapshot& snapshot, bool with_audio)
 {
     snapshot.ay3_8919 = state;
+
+    // Pending changes are at most one audio buffer ahead. They are applied to the saved
+    // copy, so that the snapshot holds the complete sound state, while the live sound
+    // keeps playing them at their own cycles.
+    if (with_audio) {
+        for (const auto& rc : changes.buffer) {
+            snapshot.ay3_8919.exec_register_change(rc);
+        }
+    }
 }
 
-void AY3_8912::load_from_snapshot(Snapshot& snapshot)
+void AY3_8912::load_from_snapshot(Snapshot& snapshot, bool with_audio)
 {
+    if (! with_audio) {
+        // Only restore what the CPU can see, sound generation continues undisturbed.
+        const AY3_8912::SoundState& saved = snapshot.ay3_8919;
+        state.bdir = saved.bdir;
+        state.bc1 = saved.bc1;
+        state.bc2 = saved.bc2;
+        state.current_register = saved.current_register;
+        std::copy(std::begin(saved.registers), std::end(saved.registers), std::begin(state.registers));
+        return;
+    }
+
+    changes.buffer.clear();
     state = snapshot.ay3_8919;
+    changes.new_log_cycle = state.cycle_count >> cycle_shift;
+    changes.update_log_cycle = true;
 }
 
 void AY3_8912::exec(uint8_t cycles)
 {
-    state.changes.exec(cycles);
+    changes.exec(cycles);
+}
+
+void AY3_8912::write_register_change(uint8_t value)
+{
+    if (changes.update_log_cycle) {
+        changes.log_cycle = changes.new_log_cycle;
+        changes.update_log_cycle = false;
+    }
+
+    changes.buffer.push_back({changes.log_cycle, state.current_register, value});
+}
+
+void AY3_8912::drain_register_changes()
+{
+    for (auto& rc : changes.buffer) {
+        state.exec_register_change(rc);
+    }
+    changes.buffer.clear();
+}
+
+void AY3_8912::trim_register_changes()
+{
+    // Change change cycles to be relative to local counting.
+    for (auto& rc : changes.buffer) {
+        if (rc.cycle > state.last_cycle)
+            rc.cycle -= state.last_cycle;
+        else
+            rc.cycle = 0;
+    }
+
+    if (changes.buffer.size() > 200) {
+        drain_register_changes();
+    }
 }
 
 void AY3_8912::update_state()
@@ -431,9 +468,9 @@ void AY3_8912::update_state()
                 case ENV_DURATION_LOW:
                 case ENV_DURATION_HIGH:
                 case ENV_SHAPE:
-                    if (! machine.warpmode_on) {
+                    if (! machine.warpmode_on && ! machine.speculative && machine.frontend) {
                         machine.frontend->lock_audio();
-                        state.write_register_change(value);
+                        write_register_change(value);
                         machine.frontend->unlock_audio();
                     }
                     break;
@@ -515,7 +552,7 @@ void AY3_8912::audio_callback(void* user_data,
     for (int i = 0; i < frames; ++i) {
         uint32_t current_cycle = ay->state.cycle_count >> cycle_shift;
 
-        ay->state.exec_register_changes(current_cycle);
+        ay->exec_register_changes(current_cycle);
         ay->state.exec_audio(current_cycle);
 
         const int16_t sample = static_cast<int16_t>(ay->state.audio_out);
@@ -527,12 +564,13 @@ void AY3_8912::audio_callback(void* user_data,
     }
 
     SDL_PutAudioStreamData(stream, ay->audio_buffer.data(), frames * bytes_per_frame);
+    ay->audio_frames_played.fetch_add(frames, std::memory_order_relaxed);
 
-    ay->state.trim_register_changes();
+    ay->trim_register_changes();
 
     ay->state.cycle_count -= ay->state.last_cycle << cycle_shift;
     ay->state.last_cycle = 0;
 
-    ay->state.changes.new_log_cycle = ay->state.cycle_count >> cycle_shift;
-    ay->state.changes.update_log_cycle = true;
+    ay->changes.new_log_cycle = ay->state.cycle_count >> cycle_shift;
+    ay->changes.update_log_cycle = true;
 }
@@ -18,7 +18,9 @@
 #ifndef AY3_8912_H
 #define AY3_8912_H
 
+#include <atomic>
 #include <print>
+#include <vector>
 #include <boost/circular_buffer.hpp>
 #include <SDL3/SDL_audio.h>
 
@@ -246,41 +248,22 @@ public:
         NUM_REGS
     };
 
+    /**
+     * State of sound generation. Trivially copyable so it can be stored in snapshots,
+     * pending register changes are kept outside of it.
+     */
     struct SoundState
     {
         SoundState();
-        ~SoundState() = default;
 
         void reset();
         void print_status();
 
-        /**
-         * Write a register change to array of changes.
-         * @param value register change to write
-         */
-        void write_register_change(uint8_t value);
-
-        /**
-         * Execute register changes.
-         * @param cycle current cycle
-         */
-        void exec_register_changes(uint32_t cycle) {
-            while (!changes.buffer.empty() && cycle >= changes.buffer[0].cycle) {
-                exec_register_change(changes.buffer[0]);
-                changes.buffer.pop_front();
-            }
-        }
-
         /**
          * Execute one register change
          * @param change change to execute
          */
-        void exec_register_change(RegisterChange& change);
-
-        /**
-         * Trim the array of register changes.
-         */
-        void trim_register_changes();
+        void exec_register_change(const RegisterChange& change);
 
         /**
          * Execute audio a number of clock cycles.
@@ -297,7 +280,6 @@ public:
         uint8_t audio_registers[NUM_REGS];
         uint32_t audio_out;
 
-        RegisterChanges changes;
         Channel channels[3];
         Noise noise;
         Envelope envelope;
@@ -322,17 +304,26 @@ public:
      */
     void print_status();
 
+    /**
+     * Calculate hash of bus control lines and registers. Sound generation state is left
+     * out, as it is advanced by the audio thread and so is not deterministic.
+     * @return state hash
+     */
+    uint64_t state_hash() const;
+
     /**
      * Save AY-3-8912 state to snapshot.
      * @param snapshot reference to snapshot
+     * @param with_audio true to include sound generation state, with pending changes applied to the saved copy
      */
-    void save_to_snapshot(Snapshot& snapshot);
+    void save_to_snapshot(Snapshot& snapshot, bool with_audio = true);
 
     /**
      * Load AY-3-8912 state from snapshot.
      * @param snapshot reference to snapshot
+     * @param with_audio true to restore sound generation state, false to only restore registers
      */
-    void load_from_snapshot(Snapshot& snapshot);
+    void load_from_snapshot(Snapshot& snapshot, bool with_audio = true);
 
     /**
      * Execute a number of clock cycles.
@@ -369,6 +360,12 @@ public:
      */
     uint8_t get_register(Register reg) { return state.registers[reg]; }
 
+    /**
+     * Get number of audio frames consumed by the audio device so far.
+     * @return number of audio frames played
+     */
+    uint64_t get_audio_frames_played() const { return audio_frames_played.load(std::memory_order_relaxed); }
+
     /**
      * Set bus direction pin value - callback function.
      * @param machine Machine object for current machine
@@ -410,9 +407,38 @@ public:
     f_write_data_handler m_write_data_handler;
 
 private:
+    /**
+     * Write a register change to array of changes.
+     * @param value register change to write
+     */
+    void write_register_change(uint8_t value);
+
+    /**
+     * Execute register changes.
+     * @param cycle current cycle
+     */
+    void exec_register_changes(uint32_t cycle) {
+        while (!changes.buffer.empty() && cycle >= changes.buffer[0].cycle) {
+            state.exec_register_change(changes.buffer[0]);
+            changes.buffer.pop_front();
+        }
+    }
+
+    /**
+     * Execute all pending register changes immediately.
+     */
+    void drain_register_changes();
+
+    /**
+     * Trim the array of register changes.
+     */
+    void trim_register_changes();
+
     Machine& machine;
     SoundState state;
+    RegisterChanges changes;
     std::vector<int16_t> audio_buffer;
+    std::atomic<uint64_t> audio_frames_played;
 };
 
 #endif // AY3_8912_H
@@ -18,6 +18,7 @@
 #include <print>
 #include <format>
 
+#include "hash.hpp"
 #include "machine.hpp"
 #include "mos6502.hpp"
 #include "mos6502_opcodes.hpp"
@@ -56,7 +57,7 @@
 #define READ_BYTE_IND_X()   memory_read_byte_handler(machine, READ_ADDR_IND_X())
 #define READ_BYTE_IND_Y()   memory_read_byte_handler(machine, READ_ADDR_IND_Y())
 
-#define PUSH_BYTE_STACK(b)  (memory.mem[STACK_BOTTOM | (SP--)] = (b))
+#define PUSH_BYTE_STACK(b)  (memory.mark_written(STACK_BOTTOM), memory.mem[STACK_BOTTOM | (SP--)] = (b))
 #define POP_BYTE_STACK()    (memory.mem[STACK_BOTTOM | (++SP)])
 
 // Macros for flag handling
@@ -136,6 +137,12 @@ void MOS6502::reset()
     current_cycle = 0;
 }
 
+uint64_t MOS6502::state_hash() const
+{
+    return fnv1a_64_values(fnv1a_64_offset, A, X, Y, get_p(), SP, PC, irq_flags, nmi_flag, do_interrupt, do_nmi,
+                           instruction_load, instruction_cycles, current_instruction, current_cycle);
+}
+
 void MOS6502::save_to_snapshot(Snapshot& snapshot) const
 {
     snapshot.mos6502.A = A;
@@ -188,6 +195,12 @@ void MOS6502::load_from_snapshot(Snapshot& snapshot)
     current_cycle = snapshot.mos6502.current_cycle;
 }
 
+void MOS6502::return_from_subroutine()
+{
+    PC = POP_BYTE_STACK();
+    PC += (POP_BYTE_STACK() << 8) + 1;
+}
+
 void MOS6502::set_breakpoint(uint16_t address)
 {
     breakpoints.insert(address);
@@ -74,6 +74,11 @@ public:
      */
     [[nodiscard]] uint16_t get_pc() const { return PC; }
 
+    /**
+     * Return from current subroutine, like an RTS instruction. Used to replace ROM routines.
+     */
+    void return_from_subroutine();
+
     /**
      * Get stack pointer address.
      * @return stack pointer address
@@ -92,6 +97,12 @@ public:
      */
     void set_p(uint8_t p);
 
+    /**
+     * Calculate hash of registers and interrupt state.
+     * @return state hash
+     */
+    [[nodiscard]] uint64_t state_hash() const;
+
     /**
      * Reset the processor.
      */
@@ -18,8 +18,10 @@
 #ifndef OPCODE_CYCLES_H
 #define OPCODE_CYCLES_H
 
+#include <cstdint>
 
-uint8_t opcode_cycles[] = {
+
+constexpr uint8_t opcode_cycles[256] = {
  // 0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
     7, 6, 0, 8, 3, 3, 5, 0, 3, 2, 2, 0, 4, 4, 6, 0,  // 0x00
     2, 5, 0, 8, 4, 4, 6, 0, 2, 4, 2, 0, 4, 4, 7, 0,  // 0x10
@@ -18,6 +18,7 @@
 #include <utility>
 #include <print>
 
+#include <hash.hpp>
 #include <machine.hpp>
 #include "mos6522.hpp"
 
@@ -83,6 +84,17 @@ void MOS6522::State::reset()
 }
 
 
+uint64_t MOS6522::State::hash() const
+{
+    uint64_t h = fnv1a_64_values(fnv1a_64_offset, ca1, ca2, ca2_do_pulse, cb1, cb2, cb2_do_pulse,
+                                 ira, ira_latch, ora, ddra, irb, irb_latch, orb, ddrb);
+    h = fnv1a_64_values(h, t1_latch_low, t1_latch_high, t1_counter, t1_run, t1_reload,
+                        t2_latch_low, t2_latch_high, t2_counter, t2_run, t2_reload);
+    return fnv1a_64_values(h, sr, sr_counter, sr_timer, sr_run, sr_first, sr_out_started, sr_out_gap_pending,
+                           acr, pcr, ifr, ier);
+}
+
+
 void MOS6522::State::print() const
 {
     std::println("VIA status:");
@@ -192,6 +204,7 @@ void MOS6522::exec(uint8_t cycles)
                         irq_set(IRQ_T1);
                         if (state.acr & 0x80) {
                             state.orb |= 0x80;    // Output 1 on PB7 if ACR7 is set.
+                            if (orb_changed_handler) { orb_changed_handler(machine, state.orb); }
                         }
                         state.t1_run = false;
                     }
@@ -213,6 +226,7 @@ void MOS6522::exec(uint8_t cycles)
 
                         if (state.acr & 0x80) {
                             state.orb ^= 0x80;    // Output squarewave on PB7 if ACR7 is set.
+                            if (orb_changed_handler) { orb_changed_handler(machine, state.orb); }
                         }
 
                         state.t1_reload = 1;
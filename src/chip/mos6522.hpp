@@ -129,6 +129,12 @@ public:
         void reset();
         void print() const;
 
+        /**
+         * Calculate hash of all registers and internal state.
+         * @return state hash
+         */
+        uint64_t hash() const;
+
         inline void sr_shift_in();
         inline void sr_shift_out();
         void sr_stop();
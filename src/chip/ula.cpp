@@ -17,7 +17,9 @@
 
 #include <vector>
 
+#include <hash.hpp>
 #include <machine.hpp>
+#include "snapshot.hpp"
 #include "ula.hpp"
 
 constexpr uint16_t raster_max = 312;
@@ -62,11 +64,21 @@ bool ULA::paint_raster()
     bool render_screen = false;
 
     if ((raster_current >= raster_visible_first) && (raster_current < raster_visible_last)) {
-        update_graphics(raster_current - raster_visible_first);
+        if (machine.video_enabled) {
+            update_graphics(raster_current - raster_visible_first);
+        }
+        else {
+            update_attributes(raster_current - raster_visible_first);
+        }
     }
 
     if (++raster_current == raster_max) {
         raster_current = 0;
+
+        // Counted for every frame, also those not shown in warp mode, as blinking and the
+        // state hash follow it.
+        frame_count++;
+
         if (machine.warpmode_on) {
             warpmode_counter = (warpmode_counter + 1) % 25;
             if (warpmode_counter) {
@@ -75,13 +87,50 @@ bool ULA::paint_raster()
         }
 
         render_screen = true;
-        machine.frontend->render_graphics(pixels);
-        frame_count++;
+        if (machine.video_enabled && machine.frontend) {
+            machine.frontend->render_graphics(pixels);
+        }
     }
 
     return render_screen;
 }
 
+uint64_t ULA::state_hash() const
+{
+    return fnv1a_64_values(fnv1a_64_offset, raster_current, video_attrib, text_attrib, blink, frame_count);
+}
+
+void ULA::save_to_snapshot(Snapshot& snapshot) const
+{
+    snapshot.ula.raster_current = raster_current;
+    snapshot.ula.video_attrib = video_attrib;
+    snapshot.ula.text_attrib = text_attrib;
+    snapshot.ula.blink = blink;
+    snapshot.ula.frame_count = frame_count;
+}
+
+void ULA::load_from_snapshot(Snapshot& snapshot)
+{
+    raster_current = snapshot.ula.raster_current;
+    video_attrib = snapshot.ula.video_attrib;
+    text_attrib = snapshot.ula.text_attrib;
+    blink = snapshot.ula.blink;
+    frame_count = snapshot.ula.frame_count;
+}
+
+uint64_t ULA::pixel_hash() const
+{
+    // FNV-1a over 64 bit words.
+    uint64_t hash = 0xcbf29ce484222325;
+    const size_t words = pixels.size() / sizeof(uint64_t);
+    const auto* data = reinterpret_cast<const uint64_t*>(pixels.data());
+
+    for (size_t i = 0; i < words; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
 
 // Return memory address corresponding to a raster line, for current video mode.
 inline uint16_t calcRowAddr(uint8_t raster_line, uint8_t video_attrib)
@@ -93,6 +142,29 @@ inline uint16_t calcRowAddr(uint8_t raster_line, uint8_t video_attrib)
 }
 
 
+void ULA::update_attributes(uint8_t raster_line)
+{
+    text_attrib = 0;
+    blink = 0x3f;
+
+    uint16_t row = calcRowAddr(raster_line, video_attrib);
+    for (uint16_t x = 0; x < 40; x++) {
+        const uint8_t ch = memory.mem[row + x];
+        if (ch & 0x60) {
+            continue;
+        }
+
+        if ((ch & 0x18) == 0x08) {
+            text_attrib = ch & 7;
+            blink = ch & 0x04 ? 0x00 : 0x3f;
+        }
+        else if ((ch & 0x18) == 0x18) {
+            video_attrib = ch & 0x07;
+            row = calcRowAddr(raster_line, video_attrib);
+        }
+    }
+}
+
 void ULA::update_graphics(uint8_t raster_line)
 {
     uint32_t bg_col = colors[0];
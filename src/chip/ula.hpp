@@ -20,6 +20,8 @@
 
 #include "frontends/sdl/frontend.hpp"
 
+class Snapshot;
+
 
 class ULA
 {
@@ -50,6 +52,42 @@ public:
      */
     bool paint_raster();
 
+    /**
+     * Check if the next raster to paint is the first of a frame.
+     * @return true at start of frame
+     */
+    bool at_frame_start() const { return raster_current == 0; }
+
+    /**
+     * Calculate hash of raster position and video attributes.
+     * @return state hash
+     */
+    uint64_t state_hash() const;
+
+    /**
+     * Save ULA state to snapshot.
+     * @param snapshot reference to snapshot
+     */
+    void save_to_snapshot(Snapshot& snapshot) const;
+
+    /**
+     * Load ULA state from snapshot.
+     * @param snapshot reference to snapshot
+     */
+    void load_from_snapshot(Snapshot& snapshot);
+
+    /**
+     * Calculate hash of the currently painted screen.
+     * @return hash of screen pixels
+     */
+    uint64_t pixel_hash() const;
+
+    /**
+     * Get the currently painted screen, texture_width * texture_height pixels in BGRA order.
+     * @return reference to screen pixels
+     */
+    const std::vector<uint8_t>& get_pixels() const { return pixels; }
+
 private:
     /**
      * Update graphics for given raster line.
@@ -57,6 +95,13 @@ private:
      */
     void update_graphics(uint8_t raster_line);
 
+    /**
+     * Decode attribute bytes of given raster line without painting it, for frames that
+     * are not shown. Video and text attributes end up as after update_graphics.
+     * @param raster_line raster line to decode
+     */
+    void update_attributes(uint8_t raster_line);
+
     Machine& machine;
     Memory& memory;
 
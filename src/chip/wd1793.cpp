@@ -18,6 +18,7 @@
 #include <boost/log/trivial.hpp>
 #include <print>
 
+#include "hash.hpp"
 #include "machine.hpp"
 #include "disk/drive.hpp"
 #include "wd1793.hpp"
@@ -41,7 +42,7 @@ void OperationIdle::write_data_reg(uint8_t value)
 uint8_t OperationReadSector::read_data_reg() const
 {
     if (wd1793.state.current_sector == nullptr) {
-        wd1793.state.current_operation = &wd1793.operation_idle;
+        wd1793.state.operation = WD1793::OperationType::Idle;
         wd1793.state.status &= ~WD1793::Status::StatusBusy;
         wd1793.state.status |= WD1793::Status::StatusRecordNotFound;
         wd1793.drive->data_request_clear();
@@ -58,8 +59,9 @@ uint8_t OperationReadSector::read_data_reg() const
     wd1793.drive->data_request_clear();
 
     if (wd1793.state.offset >= data_span.size()) {
-        if (multiple_sectors) {
+        if (wd1793.state.multiple_sectors) {
             wd1793.state.sector += 1;
+            wd1793.state.offset = 0;
             wd1793.set_sector(wd1793.state.sector);
             wd1793.state.data_request_counter = 180;
             return 0x00;
@@ -72,7 +74,7 @@ uint8_t OperationReadSector::read_data_reg() const
         wd1793.state.set_status_at_interrupt(wd1793.state.current_sector->sector_mark == 0xfb ? 0 : WD1793::StatusRecordType);
 
         wd1793.state.data_request_counter = 0;
-        wd1793.state.current_operation = &wd1793.operation_idle;
+        wd1793.state.operation = WD1793::OperationType::Idle;
     }
     else {
         wd1793.state.data_request_counter = 32;
@@ -104,9 +106,17 @@ void OperationWriteSector::write_data_reg(uint8_t value)
 
     auto data_span = wd1793.state.current_sector->data;
 
-    // Write the data byte
+    // Write the data byte. Speculative (run-ahead) frames are thrown away, and must not change the disk.
     if (wd1793.state.offset < data_span.size()) {
-        data_span[wd1793.state.offset++] = value;
+        if (! wd1793.machine.speculative) {
+            // A track shared with a forked machine is copied on first write, which moves its sectors.
+            if (wd1793.drive->get_disk_image()->prepare_write(wd1793.state.side, wd1793.state.current_track_number)) {
+                wd1793.resolve_track_and_sector();
+                data_span = wd1793.state.current_sector->data;
+            }
+            data_span[wd1793.state.offset] = value;
+        }
+        wd1793.state.offset++;
     }
 
     wd1793.state.status &= ~WD1793::Status::StatusDataRequest;
@@ -114,18 +124,22 @@ void OperationWriteSector::write_data_reg(uint8_t value)
 
     if (wd1793.state.offset >= data_span.size()) {
         // Sector write complete
-        if (multiple_sectors) {
+        if (! wd1793.machine.speculative) {
+            wd1793.drive->get_disk_image()->mark_dirty(wd1793.state.side, wd1793.state.current_track_number);
+        }
+
+        if (wd1793.state.multiple_sectors) {
             wd1793.state.sector += 1;
+            wd1793.state.offset = 0;
             wd1793.set_sector(wd1793.state.sector);
             wd1793.state.data_request_counter = 180;
             return;
         }
 
-        wd1793.drive->get_disk_image()->mark_dirty();
         wd1793.state.interrupt_counter = 32;
         wd1793.state.set_status_at_interrupt(0);  // Success
         wd1793.state.data_request_counter = 0;
-        wd1793.state.current_operation = &wd1793.operation_idle;
+        wd1793.state.operation = WD1793::OperationType::Idle;
     }
     else {
         wd1793.state.data_request_counter = 32;
@@ -147,7 +161,12 @@ void OperationReadAddress::write_data_reg(uint8_t value)
 
 uint8_t OperationReadTrack::read_data_reg() const
 {
-    uint8_t data = wd1793.state.current_track->data[wd1793.state.offset++];
+    const auto* track = wd1793.state.current_track;
+    if (! track || wd1793.state.offset >= track->data.size()) {
+        return 0x00;
+    }
+
+    uint8_t data = track->data[wd1793.state.offset++];
     wd1793.state.status &= ~WD1793::Status::StatusDataRequest;
     return data;
 }
@@ -172,6 +191,9 @@ void OperationWriteTrack::write_data_reg(uint8_t value)
 
 void WD1793::State::reset()
 {
+    operation = OperationType::Idle;
+    multiple_sectors = false;
+
     data = 0x00;
     drive = 0x00;
     side = 0x00;
@@ -199,6 +221,14 @@ void WD1793::State::print() const
 {
 }
 
+uint64_t WD1793::State::hash() const
+{
+    return fnv1a_64_values(fnv1a_64_offset, operation, multiple_sectors, data, drive, side, track, sector,
+                           command, status, current_track_number, current_sector_number, sector_type,
+                           interrupt_counter, status_at_interrupt, update_status_at_interrupt,
+                           data_request_counter, offset);
+}
+
 // ===== WD1793 =====
 
 WD1793::WD1793(Machine& a_Machine, Drive* drive) :
@@ -213,7 +243,6 @@ WD1793::WD1793(Machine& a_Machine, Drive* drive) :
     operation_write_track(*this)
 {
     state.reset();
-    state.current_operation = &operation_idle;
 }
 
 void WD1793::exec(uint8_t cycles)
@@ -238,18 +267,22 @@ void WD1793::exec(uint8_t cycles)
     if (state.data_request_counter > 0) {
         state.data_request_counter -= cycles;
         if (state.data_request_counter <= 0) {
-            state.data_request_counter = 0;
             // std::println("WD1793 *DRQ*");
-            state.status |= Status::StatusDataRequest;
-            drive->data_request_set();
+            set_data_request();
         }
     }
 }
 
+void WD1793::set_data_request()
+{
+    state.data_request_counter = 0;
+    state.status |= Status::StatusDataRequest;
+    drive->data_request_set();
+}
+
 void WD1793::reset()
 {
     state.reset();
-    state.current_operation = &operation_idle;
 }
 
 uint8_t WD1793::read_byte(uint16_t offset)
@@ -266,7 +299,7 @@ uint8_t WD1793::read_byte(uint16_t offset)
             return state.sector;
         case 0x3:
             // std::println("WD1793::read_byte(0x03) - data");
-            return state.current_operation->read_data_reg();
+            return current_operation().read_data_reg();
         default:
             break;
     };
@@ -292,7 +325,7 @@ void WD1793::write_byte(uint16_t offset, uint8_t value)
         case 0x03:
             // std::println("WD1793::write_byte - value {:02x}", value);
             state.data = value;
-            state.current_operation->write_data_reg(value);
+            current_operation().write_data_reg(value);
             break;
         default:
             break;
@@ -310,7 +343,7 @@ void WD1793::do_command(uint8_t command)
                 BOOST_LOG_TRIVIAL(debug) << "WD1793 - do command: Seek";
                 state.status = Status::StatusBusy;
                 if (command & 0x08) { state.status |= Status::StatusHeadLoaded; }
-                state.current_operation = &operation_idle;
+                state.operation = OperationType::Idle;
                 set_track(state.data);
             }
             else {
@@ -318,7 +351,7 @@ void WD1793::do_command(uint8_t command)
                 BOOST_LOG_TRIVIAL(debug) << "WD1793 - do command: Restore";
                 state.status = Status::StatusBusy;
                 if (command & 0x08) { state.status |= Status::StatusHeadLoaded; }
-                state.current_operation = &operation_idle;
+                state.operation = OperationType::Idle;
                 set_track(0);
             }
             break;
@@ -327,7 +360,7 @@ void WD1793::do_command(uint8_t command)
             BOOST_LOG_TRIVIAL(debug) << "WD1793 - do command: Step";
             state.status = Status::StatusBusy;
             if (command & 0x08) { state.status |= Status::StatusHeadLoaded; }
-            state.current_operation = &operation_idle;
+            state.operation = OperationType::Idle;
             break;
         case 0x40:
             // Step in [Type 1]: 0 1 0 u h V r₁ r₀
@@ -335,7 +368,7 @@ void WD1793::do_command(uint8_t command)
             state.status = Status::StatusBusy;
             if (command & 0x08) { state.status |= Status::StatusHeadLoaded; }
             set_track(state.current_track_number + 1);
-            state.current_operation = &operation_idle;
+            state.operation = OperationType::Idle;
             break;
         case 0x60:
             // Step out [Type 1]: 0 1 1 u h V r₁ r₀
@@ -343,7 +376,7 @@ void WD1793::do_command(uint8_t command)
             state.status = Status::StatusBusy;
             if (command & 0x08) { state.status |= Status::StatusHeadLoaded; }
             set_track(state.current_track_number - 1);
-            state.current_operation = &operation_idle;
+            state.operation = OperationType::Idle;
             break;
         case 0x80:
             // Read sector [Type 2]: 1 0 0 m F₂ E F₁ 0
@@ -351,8 +384,8 @@ void WD1793::do_command(uint8_t command)
             state.status = Status::StatusBusy | StatusNotReady;
             state.offset = 0;
             state.data_request_counter = 60;
-            operation_read_sector.multiple_sectors = command & 0x10;
-            state.current_operation = &operation_read_sector;
+            state.multiple_sectors = command & 0x10;
+            state.operation = OperationType::ReadSector;
             set_sector(state.sector);
             break;
         case 0xa0:
@@ -361,8 +394,8 @@ void WD1793::do_command(uint8_t command)
             state.status = Status::StatusBusy | StatusNotReady;
             state.offset = 0;
             state.data_request_counter = 60;
-            operation_write_sector.multiple_sectors = command & 0x10;
-            state.current_operation = &operation_write_sector;
+            state.multiple_sectors = command & 0x10;
+            state.operation = OperationType::WriteSector;
             set_sector(state.sector);
             break;
         case 0xc0:
@@ -374,13 +407,13 @@ void WD1793::do_command(uint8_t command)
                 state.interrupt_counter = 0;
                 state.data_request_counter = 0;
                 drive->interrupt_set();
-                state.current_operation = &operation_idle;
+                state.operation = OperationType::Idle;
             }
             else {
                 // Read address [Type 3]: 1 1 0 0 0 E 0 0
                 BOOST_LOG_TRIVIAL(debug) << "WD1793 - do command: Read address";
                 state.status = Status::StatusBusy | StatusNotReady | StatusDataRequest;
-                state.current_operation = &operation_read_address;
+                state.operation = OperationType::ReadAddress;
             }
             break;
         case 0xe0:
@@ -388,7 +421,7 @@ void WD1793::do_command(uint8_t command)
                 // Write track [Type 3]: 1 1 1 1 0 E 0 0
                 BOOST_LOG_TRIVIAL(debug) << "WD1793 - do command: Write track";
                 state.status = Status::StatusBusy | StatusNotReady;
-                state.current_operation = &operation_write_track;
+                state.operation = OperationType::WriteTrack;
                 state.offset = 0;
                 state.data_request_counter = 500;
             }
@@ -396,8 +429,12 @@ void WD1793::do_command(uint8_t command)
                 // Read track [Type 3]: 1 1 1 0 0 E 0 0
                 BOOST_LOG_TRIVIAL(debug) << "WD1793 - do command: Read track";
                 state.status = Status::StatusBusy | StatusNotReady;
-                state.current_operation = &operation_read_track;
+                state.operation = OperationType::ReadTrack;
                 state.offset = 0;
+                if (state.current_track) {
+                    // Images holding only sector data get their raw track built here.
+                    state.current_track->build_track_data();
+                }
                 state.data_request_counter = 60;
             }
             break;
@@ -487,6 +524,33 @@ void WD1793::save_to_snapshot(Snapshot& snapshot)
 void WD1793::load_from_snapshot(Snapshot& snapshot)
 {
     state = snapshot.wd1793;
-    set_track(state.current_track_number);
-    set_sector(state.current_sector_number);
+    resolve_track_and_sector();
+}
+
+Operation& WD1793::current_operation()
+{
+    switch (state.operation) {
+        case OperationType::ReadSector: return operation_read_sector;
+        case OperationType::WriteSector: return operation_write_sector;
+        case OperationType::ReadAddress: return operation_read_address;
+        case OperationType::ReadTrack: return operation_read_track;
+        case OperationType::WriteTrack: return operation_write_track;
+        default: return operation_idle;
+    }
+}
+
+void WD1793::resolve_track_and_sector()
+{
+    state.current_track = nullptr;
+    state.current_sector = nullptr;
+
+    auto* disk_image = drive ? drive->get_disk_image() : nullptr;
+    if (! disk_image || state.current_track_number >= disk_image->tracks_count()) {
+        return;
+    }
+
+    state.current_track = disk_image->get_track(state.side, state.current_track_number);
+    if (state.current_track) {
+        state.current_sector = state.current_track->get_sector(state.current_sector_number);
+    }
 }
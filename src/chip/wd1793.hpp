@@ -56,24 +56,18 @@ public:
 class OperationReadSector : public Operation
 {
 public:
-    OperationReadSector(WD1793& wd1793) : Operation(wd1793), multiple_sectors(false) {}
-
+    OperationReadSector(WD1793& wd1793) : Operation(wd1793) {}
     uint8_t read_data_reg() const override;
     void write_data_reg(uint8_t value) override;
-
-    bool multiple_sectors;
 };
 
 
 class OperationWriteSector : public Operation
 {
 public:
-    OperationWriteSector(WD1793& wd1793) : Operation(wd1793), multiple_sectors(false) {}
-
+    OperationWriteSector(WD1793& wd1793) : Operation(wd1793) {}
     uint8_t read_data_reg() const override;
     void write_data_reg(uint8_t value) override;
-
-    bool multiple_sectors;
 };
 
 
@@ -124,12 +118,26 @@ public:
         StatusNotReady = 0x80              // bit 7: Type I, II and III
     };
 
+    /**
+     * Operation in progress, stored as a plain value so that state can be
+     * copied into snapshots and written to disk.
+     */
+    enum class OperationType : uint8_t {
+        Idle,
+        ReadSector,
+        WriteSector,
+        ReadAddress,
+        ReadTrack,
+        WriteTrack
+    };
+
     /**
      * State of a WD1793.
      */
     struct State
     {
-        Operation* current_operation;
+        OperationType operation;
+        bool multiple_sectors;           // Multiple sector flag of current read/write command.
 
         // Registers.
         unsigned char data;
@@ -163,6 +171,12 @@ public:
         }
 
         void print() const;
+
+        /**
+         * Calculate hash of registers and internal state, except track and sector pointers.
+         * @return state hash
+         */
+        uint64_t hash() const;
     };
 
     explicit WD1793(Machine& a_Machine, Drive* drive);
@@ -178,6 +192,21 @@ public:
      */
     void reset();
 
+    /**
+     * Check if a sector transfer is waiting for its next data request.
+     * @return true if DRQ will be set after a delay
+     */
+    bool data_request_pending() const
+    {
+        return state.data_request_counter > 0 &&
+               (state.operation == OperationType::ReadSector || state.operation == OperationType::WriteSector);
+    }
+
+    /**
+     * Set data request now, instead of when the delay has passed.
+     */
+    void set_data_request();
+
     /**
      * Set drive number.
      * @param drive
@@ -209,6 +238,7 @@ public:
      * @return reference to current WD1793 state
      */
     WD1793::State& get_state() { return state; }
+    const WD1793::State& get_state() const { return state; }
 
     /**
      * Save WD1793 state to snapshot.
@@ -235,6 +265,18 @@ private:
     bool set_track(uint8_t track);
     bool set_sector(uint8_t sector);
 
+    /**
+     * Return the handler for the operation in progress.
+     * @return reference to current operation
+     */
+    Operation& current_operation();
+
+    /**
+     * Resolve current track and sector pointers from the track and sector
+     * numbers in state, without any of the side effects of set_track/set_sector.
+     */
+    void resolve_track_and_sector();
+
     Machine& machine;
     Drive* drive;
     State state;
@@ -42,9 +42,52 @@ static const char* severity_color(logging::trivial::severity_level lvl) {
 }
 
 
+static bool pacing_mode_from_string(const std::string& name, PacingMode& mode)
+{
+    if (name == "sleep") {
+        mode = PacingMode::Sleep;
+    }
+    else if (name == "hybrid") {
+        mode = PacingMode::Hybrid;
+    }
+    else if (name == "audio") {
+        mode = PacingMode::Audio;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+
+static bool disk_overlay_from_string(const std::string& name, DiskOverlay& overlay)
+{
+    if (name == "none") {
+        overlay = DiskOverlay::None;
+    }
+    else if (name == "memory") {
+        overlay = DiskOverlay::Memory;
+    }
+    else if (name == "file") {
+        overlay = DiskOverlay::File;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+
 Config::Config() :
     _start_in_monitor{false},
     _use_oric1_rom{false},
+    _disk_journal{false},
+    _disk_overlay{DiskOverlay::None},
+    _disk_fast_transfer{false},
+    _tape_fast_load{false},
+    _tape_auto_warp{false},
+    _cold_boot{false},
+    _headless{false},
     _zoom{3},
     _verbose{false},
     _roms_path{"./ROMS"},
@@ -52,7 +95,17 @@ Config::Config() :
                {RomType::OricAtmos, "basic11b.roms"},
                {RomType::Microdisk, "microdis.rom"}},
     _fonts_path{"./fonts"},
-    _images_path{"./images"}
+    _images_path{"./images"},
+    _snapshots_path{"./snapshots"},
+    _vsync{true},
+    _pacing_mode{PacingMode::Hybrid},
+    _run_ahead_frames{0},
+    _rewind_enabled{true},
+    _rewind_interval{5},
+    _rewind_keyframe_interval{50},
+    _rewind_buffer_size{32 * 1024 * 1024},
+    _boot_cache_enabled{true},
+    _boot_frames{150}
 {
 }
 
@@ -63,6 +116,13 @@ bool Config::parse(int argc, char **argv)
         po::options_description desc("Allowed options");
 
         int zoom_arg;
+        std::string pacing_arg;
+        int run_ahead_arg;
+        bool disk_journal_arg;
+        std::string disk_overlay_arg;
+        bool fast_disk_arg;
+        bool fast_load_arg;
+        bool auto_warp_arg;
 
         desc.add_options()
             ("help,?", "produce help message")
@@ -70,7 +130,22 @@ bool Config::parse(int argc, char **argv)
             ("monitor,m", po::bool_switch(&_start_in_monitor), "start in monitor mode")
             ("oric1,1", po::bool_switch(&_use_oric1_rom), "use Oric 1 mode (default: Atmos mode)")
             ("disk,d", po::value<std::filesystem::path>(&_disk_path), "disk image file to use")
+            ("disk-journal", po::bool_switch(&disk_journal_arg), "journal disk writes to survive crashes")
+            ("disk-overlay", po::value<std::string>(&disk_overlay_arg), "keep disk changes out of image: none, memory or file")
+            ("fast-disk", po::bool_switch(&fast_disk_arg), "transfer disk sectors without waiting for each byte")
             ("tape,t", po::value<std::filesystem::path>(&_tape_path), "tape image file to use")
+            ("fast-load", po::bool_switch(&fast_load_arg), "load tapes instantly via ROM routines")
+            ("auto-warp", po::bool_switch(&auto_warp_arg), "use warp mode while the tape motor is running")
+            ("record-tape", po::value<std::filesystem::path>(&_record_tape_path), "record tape output (CSAVE) to TAP file")
+            ("load-state", po::value<std::string>(&_load_state), "snapshot slot name or file to load at start")
+            ("cold-boot", po::bool_switch(&_cold_boot), "boot from reset, ignoring cached boot state")
+            ("record-movie", po::value<std::filesystem::path>(&_record_movie_path), "record keyboard input to file")
+            ("play-movie", po::value<std::filesystem::path>(&_play_movie_path), "replay keyboard input from file")
+            ("record-trace", po::value<std::filesystem::path>(&_record_trace_path), "write per-frame state hashes to file")
+            ("verify-trace", po::value<std::filesystem::path>(&_verify_trace_path), "compare per-frame state hashes with file")
+            ("headless", po::bool_switch(&_headless), "replay movie without window or sound, as fast as possible")
+            ("pacing", po::value<std::string>(&pacing_arg), "frame pacing: sleep, hybrid or audio")
+            ("run-ahead", po::value<int>(&run_ahead_arg), "frames to run ahead to reduce input latency 0-4")
             ("verbose,v", po::bool_switch(&_verbose), "verbose output");
 
         po::variables_map vm;
@@ -89,6 +164,44 @@ bool Config::parse(int argc, char **argv)
             _zoom = static_cast<uint8_t>(zoom_arg);
         }
 
+        // Only override the config file if given.
+        if (disk_journal_arg) {
+            _disk_journal = true;
+        }
+        if (fast_disk_arg) {
+            _disk_fast_transfer = true;
+        }
+        if (fast_load_arg) {
+            _tape_fast_load = true;
+        }
+        if (auto_warp_arg) {
+            _tape_auto_warp = true;
+        }
+
+        if (!vm["disk-overlay"].empty() && !disk_overlay_from_string(disk_overlay_arg, _disk_overlay)) {
+            std::println("Unknown disk overlay '{}' (use none, memory or file)", disk_overlay_arg);
+            return false;
+        }
+
+        if (!vm["pacing"].empty() && !pacing_mode_from_string(pacing_arg, _pacing_mode)) {
+            std::println("Unknown pacing mode '{}' (use sleep, hybrid or audio)", pacing_arg);
+            return false;
+        }
+
+        if (!_record_trace_path.empty() && !_verify_trace_path.empty()) {
+            std::println("--record-trace and --verify-trace can not be combined");
+            return false;
+        }
+
+        if (_headless && _play_movie_path.empty()) {
+            std::println("--headless requires --play-movie");
+            return false;
+        }
+
+        if (!vm["run-ahead"].empty()) {
+            _run_ahead_frames = static_cast<uint8_t>(std::clamp<int>(run_ahead_arg, 0, max_run_ahead_frames));
+        }
+
         if (_verbose) {
             boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::debug);
         }
@@ -157,6 +270,10 @@ bool Config::read_config_file(std::filesystem::path config_path)
         _images_path = yaml_config["media"]["images_path"].as<std::string>();
     }
 
+    if (yaml_config["media"]["snapshots_path"]) {
+        _snapshots_path = yaml_config["media"]["snapshots_path"].as<std::string>();
+    }
+
     if (yaml_config["video"]) {
         if (yaml_config["video"]["zoom"]) {
             int zoom_arg = yaml_config["video"]["zoom"].as<int>();
@@ -181,6 +298,77 @@ bool Config::read_config_file(std::filesystem::path config_path)
             vignette_arg = std::clamp<float>(vignette_arg, 0, 1);
             _vignette_strength = vignette_arg;
         }
+
+        if (yaml_config["video"]["vsync"]) {
+            _vsync = yaml_config["video"]["vsync"].as<bool>();
+        }
+    }
+
+    if (yaml_config["timing"]["pacing"]) {
+        auto pacing = yaml_config["timing"]["pacing"].as<std::string>();
+        if (! pacing_mode_from_string(pacing, _pacing_mode)) {
+            std::println("Unknown pacing mode '{}' in config file", pacing);
+        }
+    }
+
+    if (yaml_config["timing"]["run_ahead"]) {
+        int run_ahead_arg = yaml_config["timing"]["run_ahead"].as<int>();
+        _run_ahead_frames = static_cast<uint8_t>(std::clamp<int>(run_ahead_arg, 0, max_run_ahead_frames));
+    }
+
+    if (yaml_config["disk"]) {
+        if (yaml_config["disk"]["journal"]) {
+            _disk_journal = yaml_config["disk"]["journal"].as<bool>();
+        }
+
+        if (yaml_config["disk"]["fast_transfer"]) {
+            _disk_fast_transfer = yaml_config["disk"]["fast_transfer"].as<bool>();
+        }
+
+        if (yaml_config["disk"]["overlay"]) {
+            auto overlay = yaml_config["disk"]["overlay"].as<std::string>();
+            if (! disk_overlay_from_string(overlay, _disk_overlay)) {
+                std::println("Unknown disk overlay '{}' in config file", overlay);
+            }
+        }
+    }
+
+    if (yaml_config["tape"]) {
+        if (yaml_config["tape"]["fast_load"]) {
+            _tape_fast_load = yaml_config["tape"]["fast_load"].as<bool>();
+        }
+
+        if (yaml_config["tape"]["auto_warp"]) {
+            _tape_auto_warp = yaml_config["tape"]["auto_warp"].as<bool>();
+        }
+    }
+
+    if (yaml_config["rewind"]) {
+        if (yaml_config["rewind"]["enabled"]) {
+            _rewind_enabled = yaml_config["rewind"]["enabled"].as<bool>();
+        }
+
+        if (yaml_config["rewind"]["interval"]) {
+            _rewind_interval = std::clamp<uint32_t>(yaml_config["rewind"]["interval"].as<uint32_t>(), 1, 500);
+        }
+
+        if (yaml_config["rewind"]["keyframe_interval"]) {
+            _rewind_keyframe_interval = std::clamp<uint32_t>(yaml_config["rewind"]["keyframe_interval"].as<uint32_t>(), 1, 1000);
+        }
+
+        if (yaml_config["rewind"]["buffer_size_mb"]) {
+            _rewind_buffer_size = static_cast<size_t>(std::max<uint32_t>(yaml_config["rewind"]["buffer_size_mb"].as<uint32_t>(), 1)) * 1024 * 1024;
+        }
+    }
+
+    if (yaml_config["boot"]) {
+        if (yaml_config["boot"]["cache"]) {
+            _boot_cache_enabled = yaml_config["boot"]["cache"].as<bool>();
+        }
+
+        if (yaml_config["boot"]["frames"]) {
+            _boot_frames = std::clamp<uint32_t>(yaml_config["boot"]["frames"].as<uint32_t>(), 1, 3000);
+        }
     }
 
     return true;
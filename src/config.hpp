@@ -33,6 +33,31 @@ enum class RomType
 };
 
 
+/**
+ * Enum representing the ways emulation can be paced to real time.
+ */
+enum class PacingMode
+{
+    Sleep,      // Sleep until next frame.
+    Hybrid,     // Sleep until shortly before next frame, then spin.
+    Audio       // Like Hybrid, but follow the audio device clock.
+};
+
+
+/**
+ * Enum representing where changes to a disk image are kept.
+ */
+enum class DiskOverlay
+{
+    None,       // Changes are written to the disk image file.
+    Memory,     // Changes are kept in memory, the disk image file is never written.
+    File        // Changes are written to an overlay file next to the disk image file.
+};
+
+
+constexpr uint8_t max_run_ahead_frames = 4;
+
+
 class Config
 {
 public:
@@ -57,13 +82,124 @@ public:
      * Path to disk image.
      * @return path to disk image
      */
-    std::filesystem::path& disk_path() { return _disk_path; }
+    const std::filesystem::path& disk_path() const { return _disk_path; }
 
     /**
      * Path to tape image.
      * @return path to tape image
      */
-    std::filesystem::path& tape_path() { return _tape_path; }
+    const std::filesystem::path& tape_path() const { return _tape_path; }
+
+    /**
+     * Set path to disk image.
+     * @param path path to disk image, empty for no disk
+     */
+    void set_disk_path(const std::filesystem::path& path) { _disk_path = path; }
+
+    /**
+     * Set path to tape image.
+     * @param path path to tape image, empty for no tape
+     */
+    void set_tape_path(const std::filesystem::path& path) { _tape_path = path; }
+
+    /**
+     * Return whether changed disk tracks are written to a journal file before the disk
+     * image, so that an interrupted write can be completed.
+     * @return true if disk journal is enabled
+     */
+    bool disk_journal() const { return _disk_journal; }
+
+    /**
+     * Set whether changed disk tracks are written to a journal file before the disk image.
+     * @param enabled true to enable disk journal
+     */
+    void set_disk_journal(bool enabled) { _disk_journal = enabled; }
+
+    /**
+     * Return where changes to the disk image are kept.
+     * @return disk overlay mode
+     */
+    DiskOverlay disk_overlay() const { return _disk_overlay; }
+
+    /**
+     * Return whether disk sector transfers skip the wait for each byte in the standard
+     * transfer loop.
+     * @return true if fast disk transfer is enabled
+     */
+    bool disk_fast_transfer() const { return _disk_fast_transfer; }
+
+    /**
+     * Set whether disk sector transfers skip the wait for each byte in the standard
+     * transfer loop.
+     * @param enabled true to enable fast disk transfer
+     */
+    void set_disk_fast_transfer(bool enabled) { _disk_fast_transfer = enabled; }
+
+    /**
+     * Return whether TAP files are loaded instantly by trapping the ROM tape routines.
+     * @return true if tape fast load is enabled
+     */
+    bool tape_fast_load() const { return _tape_fast_load; }
+
+    /**
+     * Set whether TAP files are loaded instantly by trapping the ROM tape routines.
+     * @param enabled true to enable tape fast load
+     */
+    void set_tape_fast_load(bool enabled) { _tape_fast_load = enabled; }
+
+    /**
+     * Return whether warp mode is used while the tape motor is running.
+     * @return true if automatic warp during tape loading is enabled
+     */
+    bool tape_auto_warp() const { return _tape_auto_warp; }
+
+    /**
+     * Path to TAP file to record tape output to.
+     * @return path to TAP file, empty if none
+     */
+    const std::filesystem::path& record_tape_path() const { return _record_tape_path; }
+
+    /**
+     * Return state to load at start, either a snapshot slot name or a file path.
+     * @return state to load, empty if none
+     */
+    const std::string& load_state() const { return _load_state; }
+
+    /**
+     * Return whether to always boot from reset, ignoring the boot cache.
+     * @return true if cold boot is requested
+     */
+    bool cold_boot() const { return _cold_boot; }
+
+    /**
+     * Return file to record input to from start.
+     * @return path to movie file, empty if not recording
+     */
+    const std::filesystem::path& record_movie_path() const { return _record_movie_path; }
+
+    /**
+     * Return file to replay input from at start.
+     * @return path to movie file, empty if not replaying
+     */
+    const std::filesystem::path& play_movie_path() const { return _play_movie_path; }
+
+    /**
+     * Return file to write per-frame state hashes to.
+     * @return path to state trace file, empty if not recording
+     */
+    const std::filesystem::path& record_trace_path() const { return _record_trace_path; }
+
+    /**
+     * Return file with per-frame state hashes to compare with.
+     * @return path to state trace file, empty if not verifying
+     */
+    const std::filesystem::path& verify_trace_path() const { return _verify_trace_path; }
+
+    /**
+     * Return whether to run without window and sound, as fast as possible.
+     * @return true if headless
+     */
+    bool headless() const { return _headless; }
 
     /**
      * Check if emulator should start in monitor mode.
@@ -114,18 +250,91 @@ public:
      */
     std::filesystem::path images_path() const { return _images_path; }
 
+    /**
+     * Return directory where snapshot slots are stored.
+     * @return snapshots directory path
+     */
+    std::filesystem::path snapshots_path() const { return _snapshots_path; }
+
     bool enable_scanlines() const { return _enable_scanlines; }
     bool enable_vertical_lines() const { return _enable_vertical_lines; }
     bool enable_vignette() const { return _enable_vignette; }
 
     float vignette_strength() const { return _vignette_strength; }
 
+    /**
+     * Return whether to sync presentation to display refresh rate.
+     * @return true if vsync is enabled
+     */
+    bool vsync() const { return _vsync; }
+
+    /**
+     * Return how emulation is paced to real time.
+     * @return pacing mode
+     */
+    PacingMode pacing_mode() const { return _pacing_mode; }
+
+    /**
+     * Return number of frames to run ahead, to reduce input latency.
+     * @return number of run-ahead frames, 0 if disabled
+     */
+    uint8_t run_ahead_frames() const { return _run_ahead_frames; }
+
+    /**
+     * Return whether rewind history is recorded.
+     * @return true if rewind is enabled
+     */
+    bool rewind_enabled() const { return _rewind_enabled; }
+
+    /**
+     * Return number of frames between rewind snapshots.
+     * @return rewind snapshot interval in frames
+     */
+    uint32_t rewind_interval() const { return _rewind_interval; }
+
+    /**
+     * Return number of rewind snapshots per keyframe.
+     * @return rewind keyframe interval
+     */
+    uint32_t rewind_keyframe_interval() const { return _rewind_keyframe_interval; }
+
+    /**
+     * Return maximum size of rewind history.
+     * @return maximum rewind history size in bytes
+     */
+    size_t rewind_buffer_size() const { return _rewind_buffer_size; }
+
+    /**
+     * Return whether machine state after boot is cached, to start instantly next time.
+     * @return true if boot cache is enabled
+     */
+    bool boot_cache_enabled() const { return _boot_cache_enabled; }
+
+    /**
+     * Return minimum number of frames to run from reset before caching the boot state.
+     * @return number of boot frames
+     */
+    uint32_t boot_frames() const { return _boot_frames; }
+
 
 protected:
     bool _start_in_monitor;
     bool _use_oric1_rom;
     std::filesystem::path _disk_path;
     std::filesystem::path _tape_path;
+    bool _disk_journal;
+    DiskOverlay _disk_overlay;
+    bool _disk_fast_transfer;
+    bool _tape_fast_load;
+    bool _tape_auto_warp;
+    std::filesystem::path _record_tape_path;
+    std::string _load_state;
+    bool _cold_boot;
+    std::filesystem::path _record_movie_path;
+    std::filesystem::path _play_movie_path;
+    std::filesystem::path _record_trace_path;
+    std::filesystem::path _verify_trace_path;
+    bool _headless;
     uint8_t _zoom;
     bool _verbose;
 
@@ -136,6 +345,7 @@ protected:
     // Media
     std::filesystem::path _fonts_path;
     std::filesystem::path _images_path;
+    std::filesystem::path _snapshots_path;
 
     // Video
     bool _enable_scanlines;
@@ -143,6 +353,21 @@ protected:
     bool _enable_vignette;
 
     float _vignette_strength;
+    bool _vsync;
+
+    // Timing
+    PacingMode _pacing_mode;
+    uint8_t _run_ahead_frames;
+
+    // Rewind
+    bool _rewind_enabled;
+    uint32_t _rewind_interval;
+    uint32_t _rewind_keyframe_interval;
+    size_t _rewind_buffer_size;
+
+    // Boot
+    bool _boot_cache_enabled;
+    uint32_t _boot_frames;
 };
 
 #endif // CONFIG_H
@@ -0,0 +1,228 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <boost/log/trivial.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "disk_flusher.hpp"
+
+// Journal and overlay files: magic and track count, then per track its offset in the
+// image, its length and its data.
+constexpr char track_file_magic[8] = {'A', 'U', 'R', 'I', 'C', 'T', 'R', 'K'};
+constexpr size_t track_file_header_size = sizeof(track_file_magic) + 4;
+constexpr size_t track_entry_header_size = 8;
+
+
+DiskFlusher::DiskFlusher() :
+    busy(false),
+    thread([this](std::stop_token stop) { run(stop); })
+{
+}
+
+DiskFlusher::~DiskFlusher()
+{
+    thread.request_stop();
+    thread.join();
+}
+
+void DiskFlusher::submit(Job job)
+{
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    queue_changed.notify_one();
+}
+
+void DiskFlusher::wait()
+{
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && ! busy; });
+}
+
+void DiskFlusher::run(std::stop_token stop)
+{
+    std::unique_lock lock(mutex);
+    while (true) {
+        // Jobs queued when stopping are still written.
+        queue_changed.wait(lock, stop, [this] { return ! jobs.empty(); });
+        if (jobs.empty()) {
+            return;
+        }
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+
+        write(job);
+
+        lock.lock();
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+void DiskFlusher::write(const Job& job)
+{
+    if (! job.overlay_path.empty()) {
+        // Replaced through a temporary file, so that a crash never leaves a partial overlay.
+        auto temp_path = job.overlay_path;
+        temp_path += ".tmp";
+        std::error_code error;
+        const bool written = write_track_file(temp_path, job);
+        if (written) {
+            std::filesystem::rename(temp_path, job.overlay_path, error);
+        }
+        if (! written || error) {
+            BOOST_LOG_TRIVIAL(error) << "DiskFlusher: failed to write overlay '" << job.overlay_path.string() << "'";
+            return;
+        }
+        BOOST_LOG_TRIVIAL(debug) << "DiskFlusher: " << job.tracks.size() << " tracks written to '" << job.overlay_path.string() << "'";
+        return;
+    }
+
+    if (! job.journal_path.empty() && ! write_track_file(job.journal_path, job)) {
+        BOOST_LOG_TRIVIAL(error) << "DiskFlusher: failed to write journal, image '" << job.image_path.string() << "' not written";
+        return;
+    }
+
+    bool synced = true;
+    for (const auto& track : job.tracks) {
+        if (! track.data.empty()) {
+            std::copy(track.data.begin(), track.data.end(), job.file->writable_data() + track.offset);
+        }
+        synced &= job.file->sync(track.offset, track.length);
+    }
+
+    if (! job.journal_path.empty()) {
+        std::error_code error;
+        std::filesystem::remove(job.journal_path, error);
+    }
+
+    if (! synced) {
+        BOOST_LOG_TRIVIAL(error) << "DiskFlusher: failed to write disk image file '" << job.image_path.string() << "'";
+        return;
+    }
+    BOOST_LOG_TRIVIAL(debug) << "DiskFlusher: " << job.tracks.size() << " tracks written to '" << job.image_path.string() << "'";
+}
+
+bool DiskFlusher::write_track_file(const std::filesystem::path& path, const Job& job)
+{
+    const auto put32 = [](std::vector<uint8_t>& buffer, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            buffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    };
+
+    std::vector<uint8_t> buffer(std::begin(track_file_magic), std::end(track_file_magic));
+    put32(buffer, job.tracks.size());
+    for (const auto& track : job.tracks) {
+        put32(buffer, track.offset);
+        put32(buffer, track.length);
+        if (track.data.empty()) {
+            buffer.insert(buffer.end(), job.file->data() + track.offset, job.file->data() + track.offset + track.length);
+        }
+        else {
+            buffer.insert(buffer.end(), track.data.begin(), track.data.end());
+        }
+    }
+
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (! file) {
+        return false;
+    }
+
+    bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && std::fflush(file) == 0;
+#ifdef _WIN32
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    return std::fclose(file) == 0 && written;
+}
+
+size_t DiskFlusher::replay_journal(MappedFile& file, const std::filesystem::path& journal_path)
+{
+    // An incomplete journal means the image itself was never touched, so it is just dropped.
+    auto tracks = read_track_file(journal_path, file.size());
+    std::error_code error;
+    std::filesystem::remove(journal_path, error);
+    if (! tracks) {
+        return 0;
+    }
+
+    for (const auto& track : *tracks) {
+        std::copy(track.data.begin(), track.data.end(), file.writable_data() + track.offset);
+    }
+    file.sync(0, file.size());
+    return tracks->size();
+}
+
+std::optional<std::vector<DiskFlusher::Track>> DiskFlusher::read_track_file(const std::filesystem::path& path, size_t image_size)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (! in.is_open()) {
+        return std::nullopt;
+    }
+    std::vector<uint8_t> buffer(static_cast<size_t>(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+    in.close();
+
+    const auto get32 = [&buffer](size_t offset) {
+        uint32_t value{0};
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(buffer[offset + i]) << (i * 8);
+        }
+        return value;
+    };
+
+    if (buffer.size() < track_file_header_size ||
+        ! std::equal(std::begin(track_file_magic), std::end(track_file_magic), buffer.begin())) {
+        return std::nullopt;
+    }
+
+    std::vector<Track> tracks;
+    const size_t count = get32(sizeof(track_file_magic));
+    size_t entry = track_file_header_size;
+    for (size_t i = 0; i < count; ++i) {
+        if (entry + track_entry_header_size > buffer.size()) {
+            return std::nullopt;
+        }
+        const size_t offset = get32(entry);
+        const size_t length = get32(entry + 4);
+        entry += track_entry_header_size;
+        if (offset + length > image_size || entry + length > buffer.size()) {
+            return std::nullopt;
+        }
+        tracks.push_back({offset, length, std::vector<uint8_t>(buffer.begin() + entry, buffer.begin() + entry + length)});
+        entry += length;
+    }
+    if (entry != buffer.size()) {
+        return std::nullopt;
+    }
+    return tracks;
+}
@@ -0,0 +1,125 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef DISK_FLUSHER_H
+#define DISK_FLUSHER_H
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+
+/**
+ * Writes changed tracks to memory mapped disk image files in a thread of its own, so
+ * that emulation never waits for file I/O.
+ */
+class DiskFlusher
+{
+public:
+    /**
+     * A changed track in an image file.
+     */
+    struct Track
+    {
+        size_t offset;              // Offset of track in image file.
+        size_t length;              // Length of track.
+        std::vector<uint8_t> data;  // Track data to write, empty if already written to the mapping.
+    };
+
+    /**
+     * Tracks to write to an image file in one go.
+     */
+    struct Job
+    {
+        MappedFile* file;                       // Must stay mapped until the job is done, see wait().
+        std::filesystem::path image_path;
+        std::filesystem::path journal_path;     // Empty to write without journal.
+        std::filesystem::path overlay_path;     // Set to replace this overlay file instead of writing the image.
+        std::vector<Track> tracks;
+    };
+
+    DiskFlusher();
+
+    /**
+     * Write queued jobs, then stop the thread.
+     */
+    ~DiskFlusher();
+
+    DiskFlusher(const DiskFlusher&) = delete;
+    DiskFlusher& operator=(const DiskFlusher&) = delete;
+
+    /**
+     * Queue tracks to be written.
+     * @param job tracks to write
+     */
+    void submit(Job job);
+
+    /**
+     * Wait until all queued jobs are written.
+     */
+    void wait();
+
+    /**
+     * Apply a complete journal left by an interrupted write to an image file, and remove
+     * the journal. An incomplete journal is removed without being applied.
+     * @param file mapped image file, opened for writing
+     * @param journal_path path to journal
+     * @return number of tracks applied
+     */
+    static size_t replay_journal(MappedFile& file, const std::filesystem::path& journal_path);
+
+    /**
+     * Read a journal or overlay file.
+     * @param path path to file
+     * @param image_size size of the image file the tracks belong to
+     * @return tracks in file, std::nullopt if the file is missing, incomplete or invalid
+     */
+    static std::optional<std::vector<Track>> read_track_file(const std::filesystem::path& path, size_t image_size);
+
+protected:
+    void run(std::stop_token stop);
+
+    /**
+     * Write job to its image file, through the journal if it has one.
+     * @param job job to write
+     */
+    static void write(const Job& job);
+
+    /**
+     * Write job tracks to a journal or overlay file and wait until it is on disk.
+     * @param path path to file
+     * @param job job with tracks to write
+     * @return false if the file could not be written
+     */
+    static bool write_track_file(const std::filesystem::path& path, const Job& job);
+
+    std::mutex mutex;
+    std::condition_variable_any queue_changed;
+    std::condition_variable_any idle;
+    std::deque<Job> jobs;
+    bool busy;
+
+    std::jthread thread;    // Started last, when all other members are initialized.
+};
+
+#endif // DISK_FLUSHER_H
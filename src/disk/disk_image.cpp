@@ -16,15 +16,42 @@
 // =========================================================================
 
 #include <boost/log/trivial.hpp>
+#include <algorithm>
 #include <fstream>
 #include <print>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 #include "disk_image.hpp"
 
-constexpr uint32_t track_size = 6400;   // bytes per track
-constexpr uint32_t header_size = 256;   // bytes of header
+constexpr uint32_t mfm_track_size = 6400;  // bytes per track in MFM images
+constexpr uint32_t header_size = 256;      // bytes of header
+constexpr uint32_t sector_size = 256;      // bytes per sector in sector images
+
+// MFM track layout used when synthesising tracks from sectors, in bytes.
+constexpr uint32_t mfm_gap4a = 80;
+constexpr uint32_t mfm_gap1 = 50;
+constexpr uint32_t mfm_gap2 = 22;
+constexpr uint32_t mfm_gap3_max = 40;
+constexpr uint32_t mfm_sync = 12;
+constexpr uint32_t mfm_sector_overhead = mfm_sync + 4 + 4 + 2 + mfm_gap2 + mfm_sync + 4 + 2;
+
+
+/**
+ * CRC-CCITT as used by the WD1793 for ID and data fields, including their A1 sync marks.
+ */
+static uint16_t mfm_crc(std::span<const uint8_t> bytes)
+{
+    uint16_t crc = 0xffff;
+    for (auto byte : bytes) {
+        crc ^= byte << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
 
 
 
@@ -51,20 +78,103 @@ DiskSector::DiskSector(uint16_t sector_number, std::span<uint8_t> sector_data) :
 }
 
 
+DiskSector::DiskSector(uint16_t sector_number, std::span<uint8_t> sector_data, uint8_t sector_mark) :
+    sector_number(sector_number),
+    data(sector_data),
+    sector_mark(sector_mark),
+    valid(true)
+{
+}
+
+
 // ==== DiskTrack ============================================
 
-DiskTrack::DiskTrack(std::span<uint8_t> track_data)
+DiskTrack::DiskTrack(std::span<uint8_t> track_data) :
+    data(track_data),
+    parsed(false),
+    from_sector_data(false),
+    track_number(0),
+    side_number(0)
+{
+}
+
+DiskTrack DiskTrack::from_sectors(std::span<uint8_t> sector_data, uint8_t track_number, uint8_t side_number)
+{
+    DiskTrack track(std::span<uint8_t>{});
+    track.parsed = true;
+    track.from_sector_data = true;
+    track.track_number = track_number;
+    track.side_number = side_number;
+
+    // Sectors are numbered from 1, as on disks formatted by the Oric.
+    for (size_t offset = 0; offset + sector_size <= sector_data.size(); offset += sector_size) {
+        track.sectors.push_back(DiskSector(track.sectors.size() + 1, sector_data.subspan(offset, sector_size), 0xfb));
+    }
+    track.build_sector_lookup();
+    return track;
+}
+
+void DiskTrack::build_track_data()
+{
+    if (! from_sector_data) {
+        return;
+    }
+
+    const uint32_t sector_space = sectors.empty() ? 0 : (mfm_track_size - mfm_gap4a - mfm_sync - 4 - mfm_gap1) / sectors.size();
+    const uint32_t gap3 = std::min(mfm_gap3_max, sector_space > mfm_sector_overhead + sector_size
+                                                 ? sector_space - mfm_sector_overhead - sector_size : 0);
+
+    // A new buffer each time, as copies of the track for forked machines may still use the old one.
+    auto track = std::make_shared<std::vector<uint8_t>>();
+    track->reserve(mfm_track_size);
+    const auto add = [&track](uint32_t count, uint8_t value) { track->insert(track->end(), count, value); };
+    const auto add_crc = [&track](size_t start) {
+        const uint16_t crc = mfm_crc(std::span<const uint8_t>(track->data() + start, track->size() - start));
+        track->push_back(crc >> 8);
+        track->push_back(crc & 0xff);
+    };
+
+    add(mfm_gap4a, 0x4e);
+    add(mfm_sync, 0x00);
+    add(3, 0xc2);
+    add(1, 0xfc);
+    add(mfm_gap1, 0x4e);
+
+    for (const auto& sector : sectors) {
+        add(mfm_sync, 0x00);
+        size_t start = track->size();
+        track->insert(track->end(), {0xa1, 0xa1, 0xa1, 0xfe, track_number, side_number,
+                                     static_cast<uint8_t>(sector.sector_number), 0x01});
+        add_crc(start);
+        add(mfm_gap2, 0x4e);
+
+        add(mfm_sync, 0x00);
+        start = track->size();
+        track->insert(track->end(), {0xa1, 0xa1, 0xa1, sector.sector_mark});
+        track->insert(track->end(), sector.data.begin(), sector.data.end());
+        add_crc(start);
+        add(gap3, 0x4e);
+    }
+
+    if (track->size() < mfm_track_size) {
+        add(mfm_track_size - track->size(), 0x4e);
+    }
+
+    synthesised_track = track;
+    data = *synthesised_track;
+}
+
+void DiskTrack::parse_sectors()
 {
-    BOOST_LOG_TRIVIAL(debug) << " DiskTrack - Track data size: " << track_data.size();
+    parsed = true;
 
-    this->data = track_data;
-    auto data_ptr = track_data.begin();
-    auto data_end = track_data.end();
+    auto data_ptr = data.begin();
+    auto data_end = data.end();
 
     uint16_t sector{0};
 
     while (data_ptr < data_end) {
-        // BOOST_LOG_TRIVIAL(debug) << " -- ptr: " << std::hex << (data_ptr - track_data.begin())
+        // BOOST_LOG_TRIVIAL(debug) << " -- ptr: " << std::hex << (data_ptr - data.begin())
         //                          << " -- Searching for sector ID record for sector " << sector;
         while (data_ptr < (data_end - 10) &&
                !(data_ptr[0] == 0xa1 && data_ptr[1] == 0xa1 && data_ptr[2] == 0xa1 && data_ptr[3] == 0xfe)) {
@@ -82,7 +192,7 @@ DiskTrack::DiskTrack(std::span<uint8_t> track_data)
         auto bps = static_cast<uint16_t>(data_ptr[4]);
         auto sector_size = 128 << bps;
 
-        // BOOST_LOG_TRIVIAL(debug) << " -- ptr: " << std::hex << (data_ptr - track_data.begin())
+        // BOOST_LOG_TRIVIAL(debug) << " -- ptr: " << std::hex << (data_ptr - data.begin())
         //                          << " -- Track header: track " << track_nr
         //                          << ", side " << side_nr
         //                          << ", sector " << sector_nr
@@ -101,22 +211,27 @@ DiskTrack::DiskTrack(std::span<uint8_t> track_data)
         sectors.push_back(DiskSector(sector_nr, sector_data));
 
         auto data_pos = data_ptr;
-        // BOOST_LOG_TRIVIAL(debug) << " -- data position: " << std::hex << (data_ptr - track_data.begin());
+        // BOOST_LOG_TRIVIAL(debug) << " -- data position: " << std::hex << (data_ptr - data.begin());
 
         data_ptr += 256;
     }
-}
 
+    build_sector_lookup();
+}
 
-DiskSector* DiskTrack::get_sector(uint16_t sector_number)
+void DiskTrack::build_sector_lookup()
 {
-    for (auto& sector : sectors) {
-        if (sector.sector_number == sector_number) {
-            return &sector;
+    // Sector numbers are single bytes in the ID record, so a dense table is small. If a
+    // number occurs twice, the first sector is used.
+    for (size_t i = 0; i < sectors.size() && i < no_sector; ++i) {
+        const auto number = sectors[i].sector_number;
+        if (number >= sector_lookup.size()) {
+            sector_lookup.resize(number + 1, no_sector);
+        }
+        if (sector_lookup[number] == no_sector) {
+            sector_lookup[number] = i;
         }
     }
-
-    return nullptr;
 }
 
 
@@ -141,18 +256,25 @@ DiskTrack* DiskSide::get_track(uint8_t track)
         return nullptr;
     }
 
+    tracks[track].parse();
     return &tracks[track];
 }
 
 
 // ==== DiskImage ============================================
 
-DiskImage::DiskImage(const std::filesystem::path& path) :
+DiskImage::DiskImage(const std::filesystem::path& path, bool journal, DiskOverlay overlay) :
     image_path(path),
     image_size(0),
     side_count_(0),
     tracks_count_(0),
     geometry_(0),
+    data_offset(0),
+    track_bytes(0),
+    sectors_per_track(0),
+    persistent(true),
+    journal(journal && overlay == DiskOverlay::None),
+    overlay(overlay),
     dirty(false),
     data(nullptr)
 {
@@ -178,95 +300,357 @@ uint32_t DiskImage::read32(uint32_t offset) const
 bool DiskImage::init()
 {
     BOOST_LOG_TRIVIAL(info) << "DiskImage: Reading disk image file '" << image_path << "'";
-
-    std::ifstream file (image_path, std::ios::in | std::ios::binary | std::ios::ate);
-    if (file.is_open())
-    {
-        image_size = file.tellg();
-        memory_vector = std::vector<uint8_t>(image_size);
-        data = memory_vector.data();
-
-        file.seekg(0, std::ios::beg);
-        file.read(reinterpret_cast<char*>(data), image_size);
-        file.close();
+    const auto start_tp = std::chrono::steady_clock::now();
+
+    // Changes are written straight to a shared mapping. With an overlay, or if the file is
+    // read-only, it is mapped copy-on-write instead, and the file is never written.
+    image_file = std::make_shared<MappedFile>();
+    if (overlay == DiskOverlay::None) {
+        try {
+            image_file->open(image_path, MappedFile::Mode::ReadWrite);
+        }
+        catch (const std::runtime_error&) {
+        }
     }
-    else {
-        BOOST_LOG_TRIVIAL(warning) << "DiskImage: unable to open image file";
-        return false;
+    if (! image_file->data()) {
+        try {
+            image_file->open(image_path, MappedFile::Mode::CopyOnWrite);
+        }
+        catch (const std::runtime_error&) {
+            BOOST_LOG_TRIVIAL(warning) << "DiskImage: unable to open image file";
+            return false;
+        }
+        if (overlay == DiskOverlay::None) {
+            BOOST_LOG_TRIVIAL(warning) << "DiskImage: image file is read-only, changes will not be saved";
+        }
+        persistent = overlay == DiskOverlay::File;
+        journal = false;
     }
+    image_size = image_file->size();
+    data = image_file->writable_data();
 
-    if (memory_vector.size() >= 8 && std::equal(memory_vector.begin(), memory_vector.begin() + 8, "MFM_DISK")) {
+    if (image_size >= header_size && std::equal(data, data + 8, "MFM_DISK")) {
         BOOST_LOG_TRIVIAL(info) << "DiskImage: MFM disk image detected";
-    } else {
+        side_count_ = static_cast<uint8_t>(read32(8));
+        tracks_count_ = static_cast<uint16_t>(read32(12));
+        geometry_ = static_cast<uint8_t>(read32(16));
+        data_offset = header_size;
+        track_bytes = mfm_track_size;
+        sectors_per_track = 0;
+    }
+    else if (image_size >= header_size && std::equal(data, data + 8, "ORICDISK")) {
+        BOOST_LOG_TRIVIAL(info) << "DiskImage: sector disk image detected";
+        side_count_ = static_cast<uint8_t>(read32(8));
+        tracks_count_ = static_cast<uint16_t>(read32(12));
+        sectors_per_track = static_cast<uint8_t>(read32(16));
+        geometry_ = 1;
+        data_offset = header_size;
+        track_bytes = sectors_per_track * sector_size;
+        if (sectors_per_track == 0) {
+            BOOST_LOG_TRIVIAL(error) << "DiskImage: sector image has no sectors per track";
+            return false;
+        }
+    }
+    else if (detect_sector_dump_geometry()) {
+        BOOST_LOG_TRIVIAL(info) << "DiskImage: raw sector dump detected, assuming " << (int)side_count_
+                                << " sides, " << (int)tracks_count_ << " tracks and " << (int)sectors_per_track
+                                << " sectors per track";
+    }
+    else {
         BOOST_LOG_TRIVIAL(warning) << "DiskImage: unknown disk image format";
         return false;
     }
 
-    side_count_ = static_cast<uint8_t>(read32(8));
-    tracks_count_ = static_cast<uint16_t>(read32(12));
-    geometry_ = static_cast<uint8_t>(read32(16));
-
     BOOST_LOG_TRIVIAL(debug) << "DiskImage: sides: " << (int)side_count_
                             << ", tracks: " << (int)tracks_count_
-                            << ", geometry: " << (int)geometry_;
+                            << ", geometry: " << (int)geometry_
+                            << ", sectors per track: " << (int)sectors_per_track;
 
     BOOST_LOG_TRIVIAL(debug) << "Total size: " << image_size;
     BOOST_LOG_TRIVIAL(debug) << "data start: " << (void*)data;
 
-    for (uint8_t i = 0; i < side_count_; ++i) {
-        disk_sides.emplace_back(DiskSide(i));
+    if (side_count_ == 0 || tracks_count_ == 0 ||
+        data_offset + size_t(side_count_) * tracks_count_ * track_bytes > image_size) {
+        BOOST_LOG_TRIVIAL(error) << "DiskImage: track data out of bounds";
+        return false;
     }
 
-    size_t size_per_side = tracks_count_ * track_size;
+    track_copies.resize(side_count_ * tracks_count_);
+    dirty_tracks.resize(side_count_ * tracks_count_);
 
-    for (uint8_t side = 0; side < side_count_; ++side) {
-        BOOST_LOG_TRIVIAL(debug) << "======= DiskImage: sides: " << (int)side << " =======";
+    if (persistent && overlay == DiskOverlay::None && std::filesystem::exists(journal_path())) {
+        if (auto count = DiskFlusher::replay_journal(*image_file, journal_path())) {
+            BOOST_LOG_TRIVIAL(info) << "DiskImage: completed interrupted write of " << count << " tracks from journal";
+        }
+        else {
+            BOOST_LOG_TRIVIAL(warning) << "DiskImage: ignored incomplete journal";
+        }
+    }
 
+    // Tracks are only given their data here, sectors are located when a track is first accessed.
+    for (uint8_t side = 0; side < side_count_; ++side) {
+        disk_sides.emplace_back(DiskSide(side));
         for (uint8_t track = 0; track < tracks_count_; ++track) {
-            auto track_data = std::span<uint8_t>(data + header_size + (side * size_per_side) + (track * track_size), track_size);
-            if (track_data.data() - data > image_size) {
-                BOOST_LOG_TRIVIAL(error) << "DiskImage: track data out of bounds";
-                return false;
-            }
-
-            BOOST_LOG_TRIVIAL(debug) << "======= DiskImage: track: " << (int)track << " =======";
-            disk_sides[side].add_track(DiskTrack(track_data));
+            const size_t index = side * tracks_count_ + track;
+            disk_sides[side].add_track(make_track(index, std::span<uint8_t>(data + track_offset(index), track_bytes)));
         }
     }
 
+    if (overlay != DiskOverlay::None) {
+        load_overlay();
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "DiskImage: ready in "
+                            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_tp).count()
+                            << " ms";
     return true;
 }
 
-void DiskImage::mark_dirty()
+size_t DiskImage::track_offset(size_t index) const
+{
+    return data_offset + index * track_bytes;
+}
+
+DiskTrack DiskImage::make_track(size_t index, std::span<uint8_t> track_data) const
+{
+    if (sectors_per_track == 0) {
+        return DiskTrack(track_data);
+    }
+    return DiskTrack::from_sectors(track_data, index % tracks_count_, index / tracks_count_);
+}
+
+bool DiskImage::detect_sector_dump_geometry()
 {
+    // Raw dumps carry no header, so the geometry is guessed from the size. Sector counts used
+    // by Oric disks are tried in order of how common they are.
+    constexpr uint8_t sector_counts[] = {17, 16, 18};
+    constexpr size_t min_tracks = 35;
+    constexpr size_t max_tracks = 82;
+
+    for (auto sectors : sector_counts) {
+        const size_t bytes_per_track = size_t(sectors) * sector_size;
+        if (image_size == 0 || image_size % bytes_per_track != 0) {
+            continue;
+        }
+
+        const size_t total_tracks = image_size / bytes_per_track;
+        uint8_t sides = 0;
+        if (total_tracks >= min_tracks && total_tracks <= max_tracks) {
+            sides = 1;
+        }
+        else if (total_tracks % 2 == 0 && total_tracks / 2 >= min_tracks && total_tracks / 2 <= max_tracks) {
+            sides = 2;
+        }
+        if (sides == 0) {
+            continue;
+        }
+
+        side_count_ = sides;
+        tracks_count_ = static_cast<uint16_t>(total_tracks / sides);
+        sectors_per_track = sectors;
+        geometry_ = 1;
+        data_offset = 0;
+        track_bytes = static_cast<uint32_t>(bytes_per_track);
+        return true;
+    }
+    return false;
+}
+
+void DiskImage::mark_dirty(uint8_t side, uint8_t track)
+{
+    if (side >= side_count_ || track >= tracks_count_) {
+        return;
+    }
+
+    dirty_tracks[side * tracks_count_ + track] = true;
     dirty = true;
     last_write = std::chrono::steady_clock::now();
 }
 
 void DiskImage::flush_if_dirty()
 {
-    if (!dirty) {
+    if (!dirty || !persistent) {
+        return;
+    }
+
+    // Let a burst of sector writes finish before syncing.
+    if (std::chrono::steady_clock::now() - last_write < std::chrono::milliseconds(1000)) {
+        return;
+    }
+
+    queue_flush();
+}
+
+void DiskImage::flush()
+{
+    queue_flush();
+    if (flusher) {
+        flusher->wait();
+    }
+}
+
+void DiskImage::queue_flush()
+{
+    if (!dirty || !persistent) {
         return;
     }
 
-    const auto now = std::chrono::steady_clock::now();
-    if (now - last_write < std::chrono::milliseconds(1000)) {
+    last_write = std::chrono::steady_clock::now();
+
+    if (overlay == DiskOverlay::File) {
+        queue_overlay_write();
         return;
     }
 
-    last_write = now;
+    // Tracks copied while forks exist can't be written to the mapping without changing
+    // the disk seen by the forks. They stay dirty until the forks are gone.
+    const bool shared = image_file.use_count() > 1;
+
+    DiskFlusher::Job job{image_file.get(), image_path, journal ? journal_path() : std::filesystem::path(), {}};
+    for (size_t i = 0; i < dirty_tracks.size(); ++i) {
+        if (! dirty_tracks[i] || (shared && ! track_copies[i].empty())) {
+            continue;
+        }
+
+        // Copied tracks are handed over as copies, as emulation may keep writing to them.
+        job.tracks.push_back({track_offset(i), track_bytes, track_copies[i]});
+        dirty_tracks[i] = false;
+    }
+
+    dirty = std::find(dirty_tracks.begin(), dirty_tracks.end(), true) != dirty_tracks.end();
+
+    if (! job.tracks.empty()) {
+        submit(std::move(job));
+    }
+}
+
+void DiskImage::queue_overlay_write()
+{
+    // The whole overlay is written each time, it only holds the tracks that were changed.
+    DiskFlusher::Job job{image_file.get(), image_path, {}, overlay_path(), {}};
+    for (size_t i = 0; i < track_copies.size(); ++i) {
+        if (! track_copies[i].empty()) {
+            job.tracks.push_back({track_offset(i), track_bytes, track_copies[i]});
+        }
+    }
+
+    std::fill(dirty_tracks.begin(), dirty_tracks.end(), false);
+    dirty = false;
+
+    if (! job.tracks.empty()) {
+        submit(std::move(job));
+    }
+}
+
+void DiskImage::submit(DiskFlusher::Job job)
+{
+    if (! flusher) {
+        flusher = std::make_unique<DiskFlusher>();
+    }
+    flusher->submit(std::move(job));
+}
 
-    std::ofstream file (image_path, std::ios::out | std::ios::binary);
-    if (!file.is_open()) {
-        BOOST_LOG_TRIVIAL(error) << "DiskImage: failed to open file for writing";
+void DiskImage::load_overlay()
+{
+    auto tracks = DiskFlusher::read_track_file(overlay_path(), image_size);
+    if (! tracks) {
+        if (std::filesystem::exists(overlay_path())) {
+            BOOST_LOG_TRIVIAL(warning) << "DiskImage: ignoring invalid overlay file '" << overlay_path().string() << "'";
+        }
+        return;
     }
 
-    file.write((char*)data, image_size);
-    file.close();
+    for (auto& track : *tracks) {
+        const size_t index = (track.offset - data_offset) / track_bytes;
+        if (track.offset < data_offset || (track.offset - data_offset) % track_bytes != 0 ||
+            track.length != track_bytes || index >= track_copies.size()) {
+            continue;
+        }
+        track_copies[index] = std::move(track.data);
+        *get_track(index / tracks_count_, index % tracks_count_) = make_track(index, track_copies[index]);
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "DiskImage: loaded overlay with " << overlay_track_count() << " changed tracks";
+}
+
+void DiskImage::save_overlay()
+{
+    queue_overlay_write();
+    if (flusher) {
+        flusher->wait();
+    }
+}
 
+void DiskImage::discard_overlay()
+{
+    if (flusher) {
+        flusher->wait();
+    }
+    std::fill(dirty_tracks.begin(), dirty_tracks.end(), false);
     dirty = false;
+    persistent = false;
+
+    std::error_code error;
+    std::filesystem::remove(overlay_path(), error);
+}
+
+bool DiskImage::merge_overlay()
+{
+    if (flusher) {
+        flusher->wait();
+    }
+
+    // The image is mapped copy-on-write, so it is opened again to write to the file.
+    MappedFile master;
+    try {
+        master.open(image_path, MappedFile::Mode::ReadWrite);
+    }
+    catch (const std::runtime_error& err) {
+        BOOST_LOG_TRIVIAL(error) << "DiskImage: " << err.what();
+        return false;
+    }
+
+    for (size_t i = 0; i < track_copies.size(); ++i) {
+        if (! track_copies[i].empty()) {
+            std::copy(track_copies[i].begin(), track_copies[i].end(), master.writable_data() + track_offset(i));
+        }
+    }
+    if (! master.sync(0, master.size())) {
+        BOOST_LOG_TRIVIAL(error) << "DiskImage: failed to write disk image file '" << image_path << "'";
+        return false;
+    }
+
+    discard_overlay();
+    return true;
+}
+
+size_t DiskImage::overlay_track_count() const
+{
+    return std::count_if(track_copies.begin(), track_copies.end(), [](const auto& copy) { return ! copy.empty(); });
+}
+
+void DiskImage::print_stat() const
+{
+    static constexpr const char* overlay_names[] = {"none", "memory", "file"};
 
-    BOOST_LOG_TRIVIAL(debug) << "DiskImage: disk image file '" << image_path << "' written";
+    std::println("Disk image: {} ({} sides, {} tracks)", image_path.string(), side_count_, tracks_count_);
+    if (overlay != DiskOverlay::None) {
+        std::println("Overlay: {}, {} changed tracks", overlay_names[static_cast<int>(overlay)], overlay_track_count());
+    }
+}
+
+std::filesystem::path DiskImage::journal_path() const
+{
+    auto path = image_path;
+    path += ".journal";
+    return path;
+}
+
+std::filesystem::path DiskImage::overlay_path() const
+{
+    auto path = image_path;
+    path += ".overlay";
+    return path;
 }
 
 
@@ -278,3 +662,47 @@ DiskTrack* DiskImage::get_track(uint8_t side, uint8_t track)
 
     return disk_sides[side].get_track(track);
 }
+
+std::unique_ptr<DiskImage> DiskImage::fork() const
+{
+    auto image = std::make_unique<DiskImage>(image_path);
+    image->image_size = image_size;
+    image->side_count_ = side_count_;
+    image->tracks_count_ = tracks_count_;
+    image->geometry_ = geometry_;
+    image->data_offset = data_offset;
+    image->track_bytes = track_bytes;
+    image->sectors_per_track = sectors_per_track;
+    image->image_file = image_file;
+    image->data = data;
+    image->track_copies = track_copies;
+    image->dirty_tracks.resize(dirty_tracks.size());
+    image->persistent = false;
+    image->journal = false;
+    image->overlay = DiskOverlay::None;
+
+    // Tracks point into the shared image data, except copied tracks that must point to the new copies.
+    image->disk_sides = disk_sides;
+    for (size_t i = 0; i < track_copies.size(); ++i) {
+        if (! track_copies[i].empty()) {
+            *image->get_track(i / tracks_count_, i % tracks_count_) = image->make_track(i, image->track_copies[i]);
+        }
+    }
+
+    return image;
+}
+
+
+bool DiskImage::prepare_write(uint8_t side, uint8_t track)
+{
+    auto& copy = track_copies[side * tracks_count_ + track];
+    if (! copy.empty() || (persistent && image_file.use_count() == 1 && ! journal && overlay == DiskOverlay::None)) {
+        return false;
+    }
+
+    // Copied from the image rather than the track, whose data may be a synthesised MFM track.
+    const size_t index = side * tracks_count_ + track;
+    copy.assign(data + track_offset(index), data + track_offset(index) + track_bytes);
+    *get_track(side, track) = make_track(index, copy);
+    return true;
+}
@@ -18,9 +18,15 @@
 #ifndef DISK_IMAGE_H
 #define DISK_IMAGE_H
 
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <span>
+#include <vector>
 
+#include "config.hpp"
+#include "disk_flusher.hpp"
+#include "mapped_file.hpp"
 
 /**
  * Represents a single sector on a disk.
@@ -34,6 +40,14 @@ public:
      */
     DiskSector(uint16_t sector_number, std::span<uint8_t> sector_data);
 
+    /**
+     * Create a sector from data without ID byte and CRC, as in sector dump images.
+     * @param sector_number Number of the sector.
+     * @param sector_data Sector data as a byte span.
+     * @param sector_mark Data address mark, 0xfb for normal and 0xf8 for deleted data.
+     */
+    DiskSector(uint16_t sector_number, std::span<uint8_t> sector_data, uint8_t sector_mark);
+
     uint16_t sector_number;
     std::span<uint8_t> data;
     uint8_t sector_mark;
@@ -49,16 +63,54 @@ class DiskTrack
 {
 public:
     /**
+     * Create a track. Sectors are not located until the track is parsed.
      * @param track_data Track data as a byte span.
      */
     DiskTrack(std::span<uint8_t> track_data);
 
     /**
-     * Get sector from the disk track.
+     * Create a track from consecutive 256 byte sectors, as in sector dump images. The MFM
+     * track data is only synthesised when needed, see build_track_data().
+     * @param sector_data Sector data as a byte span.
+     * @param track_number Track number, for synthesised sector IDs.
+     * @param side_number Side number, for synthesised sector IDs.
+     * @return new track
+     */
+    static DiskTrack from_sectors(std::span<uint8_t> sector_data, uint8_t track_number, uint8_t side_number);
+
+    /**
+     * Make data hold the whole MFM track, as read by a Read Track command. For tracks made
+     * from sectors the track is synthesised from the current sector contents, otherwise
+     * data already holds the track.
+     */
+    void build_track_data();
+
+    /**
+     * Locate the sectors of the track, unless already done. Tracks are parsed on first
+     * access instead of when the image is loaded, so inserting large images is fast.
+     */
+    void parse()
+    {
+        if (! parsed) {
+            parse_sectors();
+        }
+    }
+
+    bool is_parsed() const { return parsed; }
+
+    /**
+     * Get sector from the disk track. The track must have been parsed.
      * @param sector_number number of sector to retrieve.
      * @return Pointer to the disk sector if found, nullptr otherwise.
      */
-    DiskSector* get_sector(uint16_t sector_number);
+    DiskSector* get_sector(uint16_t sector_number)
+    {
+        if (sector_number >= sector_lookup.size() || sector_lookup[sector_number] == no_sector) {
+            return nullptr;
+        }
+        return &sectors[sector_lookup[sector_number]];
+    }
+
     uint8_t sector_count() const { return sectors.size(); }
 
     /**
@@ -67,7 +119,18 @@ public:
     std::span<uint8_t> data;
 
 private:
+    static constexpr uint8_t no_sector = 0xff;
+
+    void parse_sectors();
+    void build_sector_lookup();
+
+    bool parsed;
+    bool from_sector_data;                                  // Made from sectors, data is synthesised.
+    uint8_t track_number;
+    uint8_t side_number;
+    std::shared_ptr<std::vector<uint8_t>> synthesised_track;   // Shared by copies, replaced when rebuilt.
     std::vector<DiskSector> sectors;
+    std::vector<uint8_t> sector_lookup;     // Index in sectors by sector number. Indexes stay valid when copied.
 };
 
 /**
@@ -88,7 +151,7 @@ public:
     void add_track(DiskTrack track);
 
     /**
-     * Get a track from the disk side.
+     * Get a track from the disk side, parsing it on first access.
      * @param track Track number (0-based).
      * @return Pointer to the disk track if found, nullptr otherwise.
      */
@@ -102,14 +165,28 @@ protected:
 /**
  * Represents a disk image with multiple sides and tracks.
  * Normally the number of sides is 1 or 2, depending on the disk type.
+ *
+ * MFM images (MFM_DISK) hold whole MFM tracks. Oricutron's old format (ORICDISK) and
+ * raw sector dumps only hold 256 byte sectors, and MFM tracks are synthesised from them
+ * when a track is read as a whole.
+ *
+ * The image file is memory mapped, and written tracks are synced back to the file
+ * one track at a time by a DiskFlusher thread. If the file can't be written, changes
+ * are kept in memory only.
+ *
+ * With an overlay, the image file is only read. Written tracks are kept as copies in
+ * memory, and with DiskOverlay::File also saved to an overlay file next to the image.
  */
 class DiskImage
 {
 public:
     /**
      * @param path Path to disk image file.
+     * @param journal True to write changed tracks to a journal file before the image, so
+     *                that an interrupted write can be completed next time the image is used.
+     * @param overlay Where changes are kept, see DiskOverlay.
      */
-    DiskImage(const std::filesystem::path& path);
+    DiskImage(const std::filesystem::path& path, bool journal = false, DiskOverlay overlay = DiskOverlay::None);
 
     ~DiskImage();
 
@@ -119,11 +196,75 @@ public:
      */
     bool init();
 
-    void mark_dirty();
+    /**
+     * Mark a track as changed, to be written to the image file.
+     * @param side Side number (0-based).
+     * @param track Track number (0-based).
+     */
+    void mark_dirty(uint8_t side, uint8_t track);
+
+    /**
+     * Queue changed tracks to be written to the image file in the background, if the
+     * last write was at least a second ago. Never waits for file I/O.
+     */
     void flush_if_dirty();
 
     /**
-     * Get a track from the specified side and track number.
+     * Write changed tracks to the image file now, and wait until done.
+     */
+    void flush();
+
+    /**
+     * Write all tracks changed in the overlay to the overlay file, and wait until done.
+     */
+    void save_overlay();
+
+    /**
+     * Remove the overlay file and stop saving changes. The changes stay in memory until
+     * the image is loaded again.
+     */
+    void discard_overlay();
+
+    /**
+     * Write tracks changed in the overlay to the image file, and remove the overlay file.
+     * @return false if the image file could not be written
+     */
+    bool merge_overlay();
+
+    /**
+     * Get number of tracks changed in the overlay.
+     * @return number of changed tracks
+     */
+    size_t overlay_track_count() const;
+
+    DiskOverlay overlay_mode() const { return overlay; }
+    const std::filesystem::path& path() const { return image_path; }
+
+    /**
+     * Print image and overlay status to console.
+     */
+    void print_stat() const;
+
+    /**
+     * Create a copy of the disk image for a forked machine. Track data is shared
+     * between the copies until either of them writes to a track, see prepare_write().
+     * The copy is never written back to the image file.
+     * @return new disk image
+     */
+    std::unique_ptr<DiskImage> fork() const;
+
+    /**
+     * Make a track safe to write to. Tracks are only written in place in an image file
+     * that is saved to and not shared with forks. Otherwise, or if writes are journaled or
+     * kept in an overlay, the track is copied first, which moves its DiskTrack sectors.
+     * @param side Side number (0-based).
+     * @param track Track number (0-based).
+     * @return true if the track was copied, and pointers to its sectors must be looked up again
+     */
+    bool prepare_write(uint8_t side, uint8_t track);
+
+    /**
+     * Get a track from the specified side and track number, parsing it on first access.
      * @param side Side number (0-based).
      * @param track Track number (0-based).
      * @return Pointer to the disk track if found, nullptr otherwise.
@@ -148,17 +289,75 @@ public:
      */
     uint8_t tracks_count() const { return tracks_count_; }
 
+    /**
+     * Get path of the overlay file, used with DiskOverlay::File.
+     * @return overlay file path
+     */
+    std::filesystem::path overlay_path() const;
+
 protected:
     uint32_t read32(uint32_t offset) const;
 
+    /**
+     * Get offset of a track in the image file.
+     * @param index track index, side * tracks_count_ + track
+     * @return offset in image file
+     */
+    size_t track_offset(size_t index) const;
+
+    std::filesystem::path journal_path() const;
+
+    /**
+     * Create track for the given track data in the format of the image.
+     * @param index track index, side * tracks_count_ + track
+     * @param track_data track data in image file format
+     * @return new track
+     */
+    DiskTrack make_track(size_t index, std::span<uint8_t> track_data) const;
+
+    /**
+     * Find geometry of a raw sector dump from its size.
+     * @return false if the size doesn't match any usual geometry
+     */
+    bool detect_sector_dump_geometry();
+
+    /**
+     * Queue changed tracks to be written by the flusher.
+     */
+    void queue_flush();
+
+    /**
+     * Queue all tracks changed in the overlay to be written to the overlay file.
+     */
+    void queue_overlay_write();
+
+    /**
+     * Queue job for the flusher, starting it if needed.
+     * @param job tracks to write
+     */
+    void submit(DiskFlusher::Job job);
+
+    /**
+     * Load tracks from the overlay file, if there is one.
+     */
+    void load_overlay();
+
     std::filesystem::path image_path;
     size_t image_size;
 
     uint8_t side_count_;
     uint16_t tracks_count_;
     uint8_t geometry_;
+    uint32_t data_offset;           // Offset of first track in image file.
+    uint32_t track_bytes;           // Size of each track in image file.
+    uint8_t sectors_per_track;      // For sector images, 0 for MFM images.
 
-    std::vector<uint8_t> memory_vector;
+    std::shared_ptr<MappedFile> image_file;                 // Shared with forks.
+    std::vector<std::vector<uint8_t>> track_copies;         // Tracks written while shared or journaled, per side and track.
+    std::vector<bool> dirty_tracks;                         // Tracks changed since last flush, per side and track.
+    bool persistent;                                        // False for forks, read-only files and memory overlays, never written to file.
+    bool journal;
+    DiskOverlay overlay;
 
     bool dirty;
     std::chrono::steady_clock::time_point last_write{};
@@ -166,6 +365,8 @@ protected:
     uint8_t* data;
 
     std::vector<DiskSide> disk_sides;
+
+    std::unique_ptr<DiskFlusher> flusher;   // Created on first flush. Destroyed first, as it writes to image_file.
 };
 
 
@@ -19,8 +19,10 @@
 #define DRIVE_H
 
 #include <filesystem>
+#include <memory>
 
 class DiskImage;
+class Machine;
 class Snapshot;
 
 
@@ -74,6 +76,12 @@ public:
      */
     virtual void exec_once_per_frame() = 0;
 
+    /**
+     * Check if drive is executing a command.
+     * @return true if drive is busy
+     */
+    virtual bool is_busy() = 0;
+
     /**
      * Set interrupt request. Sets CPU interrupt flag if interrupts are enabled in status.
      */
@@ -108,6 +116,20 @@ public:
      */
     virtual void write_byte(uint16_t offset, uint8_t value) = 0;
 
+    /**
+     * Calculate hash of drive and controller state.
+     * @return state hash
+     */
+    virtual uint64_t state_hash() const = 0;
+
+    /**
+     * Create a copy of the drive with the same disk, for a forked machine. Drive and
+     * controller state are not copied, they are restored from a snapshot.
+     * @param machine the forked machine
+     * @return new drive
+     */
+    virtual std::unique_ptr<Drive> fork(Machine& machine) const = 0;
+
     /**
      * Save Drive state to snapshot.
      * @param snapshot reference to snapshot
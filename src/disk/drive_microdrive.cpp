@@ -19,6 +19,7 @@
 #include <machine.hpp>
 
 #include "drive_microdrive.hpp"
+#include "hash.hpp"
 
 #include <print>
 #include <random>
@@ -26,14 +27,17 @@
 
 DriveMicrodrive::DriveMicrodrive(Machine& machine) :
     machine(machine),
-    wd1793(machine, this)
+    wd1793(machine, this),
+    fast_transfer(machine.get_config().disk_fast_transfer())
 {
     state.reset();
 }
 
 DriveMicrodrive::~DriveMicrodrive()
 {
-    disk_image->flush_if_dirty();
+    if (disk_image) {
+        disk_image->flush();
+    }
 }
 
 void DriveMicrodrive::State::reset()
@@ -56,7 +60,11 @@ bool DriveMicrodrive::insert_disk(const std::filesystem::path& path)
     }
 
     disk_image_path = path;
-    disk_image = std::make_unique<DiskImage>(disk_image_path);
+    if (disk_image) {
+        disk_image->flush();
+    }
+    disk_image = std::make_unique<DiskImage>(disk_image_path, machine.get_config().disk_journal(),
+                                             machine.get_config().disk_overlay());
     disk_image->init();
 
     return true;
@@ -88,6 +96,11 @@ void DriveMicrodrive::exec_once_per_frame()
     disk_image->flush_if_dirty();
 }
 
+bool DriveMicrodrive::is_busy()
+{
+    return wd1793.get_state().status & WD1793::StatusBusy;
+}
+
 void DriveMicrodrive::interrupt_set()
 {
     state.interrupt_request = 0x00;
@@ -123,12 +136,25 @@ uint8_t DriveMicrodrive::read_byte(uint16_t offset)
 
     if (offset == 0x8) {
         // std::println("--- DRQ READ ---");
+        if (fast_transfer && state.data_request && wd1793.data_request_pending() && in_data_request_loop()) {
+            wd1793.set_data_request();
+        }
         return state.data_request | 0x7f;
     }
 
     return wd1793.read_byte(offset);
 }
 
+bool DriveMicrodrive::in_data_request_loop() const
+{
+    // The DRQ register is read by an absolute instruction, so PC is just past it.
+    const uint16_t pc = machine.cpu->get_pc();
+    const uint8_t opcode = Machine::read_byte(machine, pc - 3);
+    return (opcode == 0xad || opcode == 0x2c) &&
+           Machine::read_byte(machine, pc - 2) == 0x18 && Machine::read_byte(machine, pc - 1) == 0x03 &&
+           Machine::read_byte(machine, pc) == 0x30 && Machine::read_byte(machine, pc + 1) == 0xfb;
+}
+
 void DriveMicrodrive::write_byte(uint16_t offset, uint8_t value)
 {
     // std::println("Microdrive write: {:04x} <- {:02x}", offset, value);
@@ -157,6 +183,21 @@ void DriveMicrodrive::write_byte(uint16_t offset, uint8_t value)
     return wd1793.write_byte(offset, value);
 }
 
+uint64_t DriveMicrodrive::state_hash() const
+{
+    return fnv1a_64_values(wd1793.get_state().hash(), state.status, state.interrupt_request, state.data_request);
+}
+
+std::unique_ptr<Drive> DriveMicrodrive::fork(Machine& machine) const
+{
+    auto drive = std::make_unique<DriveMicrodrive>(machine);
+    drive->disk_image_path = disk_image_path;
+    if (disk_image) {
+        drive->disk_image = disk_image->fork();
+    }
+    return drive;
+}
+
 void DriveMicrodrive::save_to_snapshot(Snapshot& snapshot)
 {
     snapshot.drive_microdrive = state;
@@ -97,6 +97,12 @@ public:
      */
     void exec_once_per_frame() override;
 
+    /**
+     * Check if drive is executing a command.
+     * @return true if drive is busy
+     */
+    bool is_busy() override;
+
     /**
      * Set interrupt request. Sets CPU interrupt flag if interrupts are enabled in status.
      */
@@ -131,6 +137,19 @@ public:
      */
     void write_byte(uint16_t offset, uint8_t value) override;
 
+    /**
+     * Calculate hash of drive and controller state.
+     * @return state hash
+     */
+    uint64_t state_hash() const override;
+
+    /**
+     * Create a copy of the drive with the same disk, for a forked machine.
+     * @param machine the forked machine
+     * @return new drive
+     */
+    std::unique_ptr<Drive> fork(Machine& machine) const override;
+
     /**
      * Save DriveMicrodrive state to snapshot.
      * @param snapshot reference to snapshot
@@ -144,8 +163,17 @@ public:
     void load_from_snapshot(Snapshot& snapshot) override;
 
 protected:
+    /**
+     * Check if the CPU is polling DRQ in the standard sector transfer loop, LDA $0318 or
+     * BIT $0318 followed by BMI back to it. Other loops, as in copy protections, keep
+     * accurate timing.
+     * @return true if DRQ can be set immediately
+     */
+    bool in_data_request_loop() const;
+
     Machine& machine;
     WD1793 wd1793;
+    bool fast_transfer;     // Set DRQ immediately when polled by the standard loop.
 
     State state;
 
@@ -18,6 +18,7 @@
 #include <print>
 
 #include "drive_none.hpp"
+#include "hash.hpp"
 
 
 bool DriveNone::init()
@@ -49,6 +50,11 @@ void DriveNone::exec(uint8_t cycles)
 void DriveNone::exec_once_per_frame()
 {}
 
+bool DriveNone::is_busy()
+{
+    return false;
+}
+
 void DriveNone::interrupt_set()
 {}
 
@@ -69,6 +75,16 @@ uint8_t DriveNone::read_byte(uint16_t offset)
 void DriveNone::write_byte(uint16_t offset, uint8_t value)
 {}
 
+uint64_t DriveNone::state_hash() const
+{
+    return fnv1a_64_offset;
+}
+
+std::unique_ptr<Drive> DriveNone::fork(Machine& machine) const
+{
+    return std::make_unique<DriveNone>();
+}
+
 void DriveNone::save_to_snapshot(Snapshot& snapshot)
 {
 }
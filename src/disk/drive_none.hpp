@@ -71,6 +71,12 @@ public:
      */
     void exec_once_per_frame() override;
 
+    /**
+     * Check if drive is executing a command.
+     * @return true if drive is busy
+     */
+    bool is_busy() override;
+
     /**
      * Set interrupt request. Sets CPU interrupt flag if interrupts are enabled in status.
      */
@@ -105,6 +111,19 @@ public:
      */
     void write_byte(uint16_t offset, uint8_t value) override;
 
+    /**
+     * Calculate hash of drive state.
+     * @return state hash
+     */
+    uint64_t state_hash() const override;
+
+    /**
+     * Create a copy of the drive with the same disk, for a forked machine.
+     * @param machine the forked machine
+     * @return new drive
+     */
+    std::unique_ptr<Drive> fork(Machine& machine) const override;
+
     /**
      * Save Drive state to snapshot.
      * @param snapshot reference to snapshot
@@ -0,0 +1,207 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <print>
+#include <string>
+#include <thread>
+
+#include "frame_pacer.hpp"
+
+using namespace std::chrono_literals;
+
+constexpr auto frame_duration = 20ms;
+constexpr std::chrono::microseconds frame_duration_us = frame_duration;
+
+// In hybrid mode, sleep until this long before the deadline and then spin. Sleep wakeups are
+// commonly late by a millisecond or more, which shows up as judder and audio underruns.
+constexpr auto spin_margin = 2ms;
+
+// Audio pacing: fraction of the drift between emulated time and audio device time that is
+// corrected each frame, and the largest correction allowed for a single frame.
+constexpr uint32_t audio_frequency = 44100;
+constexpr double audio_drift_gain = 0.1;
+constexpr double audio_max_adjust_ms = 4.0;
+
+// The audio device consumes data in chunks longer than a frame, so the played count only moves
+// every few frames and jumps when it does. Audio counts as paused after this many frames
+// without progress, and the drift is smoothed over several chunks.
+constexpr uint32_t audio_stall_frames = 10;
+constexpr double audio_drift_smoothing = 0.2;
+
+
+FramePacer::FramePacer(PacingMode mode) :
+    mode(mode),
+    has_last_frame(false),
+    audio_synced(false),
+    audio_frames_at_sync(0),
+    last_audio_frames(0),
+    frames_since_sync(0),
+    frames_without_audio(0),
+    drift_ms(0.0)
+{
+    restart();
+    reset_histogram();
+}
+
+void FramePacer::restart()
+{
+    next_frame_tp = hrc::now();
+    has_last_frame = false;
+    audio_synced = false;
+}
+
+void FramePacer::wait_for_next_frame(uint64_t audio_frames_played)
+{
+    next_frame_tp += frame_duration;
+
+    if (mode == PacingMode::Audio) {
+        follow_audio_clock(audio_frames_played);
+    }
+
+    hrc::time_point now_tp = hrc::now();
+    if (now_tp > next_frame_tp) {
+        // Running late, don't try to catch up.
+        next_frame_tp = now_tp;
+    }
+    else {
+        sleep_until(next_frame_tp);
+        now_tp = hrc::now();
+    }
+
+    record_frame_time(now_tp);
+}
+
+void FramePacer::sleep_until(hrc::time_point tp) const
+{
+    if (mode == PacingMode::Sleep) {
+        std::this_thread::sleep_until(tp);
+        return;
+    }
+
+    if (tp - hrc::now() > spin_margin) {
+        std::this_thread::sleep_until(tp - spin_margin);
+    }
+
+    while (hrc::now() < tp) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::follow_audio_clock(uint64_t audio_frames_played)
+{
+    const bool progress = audio_frames_played != last_audio_frames;
+    last_audio_frames = audio_frames_played;
+
+    // Synchronize when the audio device has consumed something, until then (paused or not
+    // started) pace by the system clock alone.
+    if (! audio_synced) {
+        if (progress) {
+            audio_synced = true;
+            audio_frames_at_sync = audio_frames_played;
+            frames_since_sync = 0;
+            frames_without_audio = 0;
+            drift_ms = 0.0;
+        }
+        return;
+    }
+
+    ++frames_since_sync;
+
+    // Between chunks the drift can't be measured, keep the current pace.
+    if (! progress) {
+        if (++frames_without_audio >= audio_stall_frames) {
+            audio_synced = false;
+        }
+        return;
+    }
+    frames_without_audio = 0;
+
+    const double emulated_ms = static_cast<double>(frames_since_sync * frame_duration.count());
+    const double audio_ms = static_cast<double>(audio_frames_played - audio_frames_at_sync) * 1000.0 / audio_frequency;
+    drift_ms += (emulated_ms - audio_ms - drift_ms) * audio_drift_smoothing;
+
+    // Positive drift: emulation is ahead of the audio device, wait a little longer.
+    const double adjust_ms = std::clamp(drift_ms * audio_drift_gain, -audio_max_adjust_ms, audio_max_adjust_ms);
+
+    next_frame_tp += std::chrono::microseconds(static_cast<int64_t>(adjust_ms * 1000.0));
+}
+
+void FramePacer::record_frame_time(hrc::time_point now)
+{
+    if (has_last_frame) {
+        auto frame_time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - last_frame_tp).count());
+
+        size_t bucket = std::min<size_t>(frame_time / 1000, histogram_buckets - 1);
+        ++histogram[bucket];
+
+        ++frame_time_count;
+        frame_time_sum += frame_time;
+        frame_time_sum_squares += static_cast<double>(frame_time) * static_cast<double>(frame_time);
+        frame_time_min = std::min(frame_time_min, frame_time);
+        frame_time_max = std::max(frame_time_max, frame_time);
+    }
+
+    last_frame_tp = now;
+    has_last_frame = true;
+}
+
+void FramePacer::reset_histogram()
+{
+    histogram.fill(0);
+    frame_time_count = 0;
+    frame_time_sum = 0;
+    frame_time_sum_squares = 0.0;
+    frame_time_min = UINT64_MAX;
+    frame_time_max = 0;
+}
+
+void FramePacer::print_histogram() const
+{
+    static const char* mode_names[] = {"sleep", "hybrid", "audio"};
+
+    std::println("Frame times ({} pacing, target {} us):", mode_names[static_cast<int>(mode)], frame_duration_us.count());
+
+    if (frame_time_count == 0) {
+        std::println("    No frames recorded.");
+        return;
+    }
+
+    const double mean = static_cast<double>(frame_time_sum) / frame_time_count;
+    const double variance = frame_time_sum_squares / frame_time_count - mean * mean;
+
+    std::println("    frames: {}, mean: {:.0f} us, std dev: {:.0f} us, min: {} us, max: {} us",
+                 frame_time_count, mean, std::sqrt(std::max(variance, 0.0)), frame_time_min, frame_time_max);
+
+    const uint32_t max_count = *std::max_element(histogram.begin(), histogram.end());
+
+    for (size_t i = 0; i < histogram_buckets; ++i) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+
+        const size_t bar_length = std::max<size_t>(1, histogram[i] * 50 / max_count);
+
+        if (i == histogram_buckets - 1) {
+            std::println("    >={:2} ms {:8} {}", i, histogram[i], std::string(bar_length, '#'));
+        }
+        else {
+            std::println("    {:4} ms {:8} {}", i, histogram[i], std::string(bar_length, '#'));
+        }
+    }
+}
@@ -0,0 +1,116 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "config.hpp"
+
+
+/**
+ * Paces emulation to real time, one 50 Hz frame at a time, and keeps
+ * statistics of the real time between frames.
+ */
+class FramePacer
+{
+public:
+    explicit FramePacer(PacingMode mode);
+
+    /**
+     * Set pacing mode.
+     * @param mode new pacing mode
+     */
+    void set_mode(PacingMode mode) { this->mode = mode; restart(); }
+
+    /**
+     * Get current pacing mode.
+     * @return current pacing mode
+     */
+    PacingMode get_mode() const { return mode; }
+
+    /**
+     * Restart pacing from current time. Used after warp mode, breaks, etc.
+     */
+    void restart();
+
+    /**
+     * Wait until it is time to emulate the next frame.
+     * @param audio_frames_played number of audio frames consumed by the audio device so far
+     */
+    void wait_for_next_frame(uint64_t audio_frames_played);
+
+    /**
+     * Print histogram of frame times to console.
+     */
+    void print_histogram() const;
+
+    /**
+     * Clear collected frame time statistics.
+     */
+    void reset_histogram();
+
+protected:
+    using hrc = std::chrono::high_resolution_clock;
+
+    static constexpr size_t histogram_buckets = 50;     // 1 ms per bucket, last is overflow.
+
+    /**
+     * Sleep until given time point, according to current pacing mode.
+     * @param tp time point to wait for
+     */
+    void sleep_until(hrc::time_point tp) const;
+
+    /**
+     * Adjust next frame time to follow the audio device clock.
+     * @param audio_frames_played number of audio frames consumed by the audio device so far
+     */
+    void follow_audio_clock(uint64_t audio_frames_played);
+
+    /**
+     * Add time since last frame to statistics.
+     * @param now current time
+     */
+    void record_frame_time(hrc::time_point now);
+
+    PacingMode mode;
+
+    hrc::time_point next_frame_tp;
+    hrc::time_point last_frame_tp;
+    bool has_last_frame;
+
+    // Audio clock following.
+    bool audio_synced;
+    uint64_t audio_frames_at_sync;
+    uint64_t last_audio_frames;
+    uint64_t frames_since_sync;
+    uint32_t frames_without_audio;     // Frames since the audio device last consumed anything.
+    double drift_ms;                   // Smoothed drift of emulated time ahead of audio time.
+
+    // Frame time statistics, in microseconds.
+    std::array<uint32_t, histogram_buckets> histogram;
+    uint64_t frame_time_count;
+    uint64_t frame_time_sum;
+    uint64_t frame_time_min;
+    uint64_t frame_time_max;
+    double frame_time_sum_squares;
+};
+
+#endif // FRAME_PACER_H
@@ -22,6 +22,9 @@ enum StatusbarFlags : uint16_t
 {
     warp_mode = 1,
     loading = 2,
+    rewinding = 4,
+    recording = 8,
+    playing = 16,
 };
 
 #endif // FRONTENDS_FLAGS_H
@@ -17,6 +17,7 @@
 
 #include "gui.hpp"
 
+#include <format>
 #include <imgui.h>
 #include <imgui_impl_sdl3.h>
 #include <imgui_impl_opengl3.h>
@@ -102,6 +103,16 @@ void Gui::render()
             oric.get_machine().eject_tape();
         }
 
+        const auto& tape_blocks = oric.get_machine().get_tape().get_blocks();
+        for (size_t i = 0; i < tape_blocks.size(); i++) {
+            const auto label = std::format("{}: {}", i, tape_blocks[i].name);
+            ImGui::PushID(static_cast<int>(i));
+            if (ImGui::Selectable(label.c_str())) {
+                oric.get_machine().seek_tape_block(i);
+            }
+            ImGui::PopID();
+        }
+
         ImGui::Text("Disk:");
         if (ImGui::Button("Insert disk")) {
             auto result = oric.get_frontend().select_file("Choose disk file");
@@ -15,6 +15,7 @@
 //   along with this program.  If not, see <http://www.gnu.org/licenses/>
 // =========================================================================
 
+#include <format>
 #include <imgui.h>
 
 #include "status_bar.hpp"
@@ -30,7 +31,8 @@ StatusBar::StatusBar(uint16_t width, uint16_t height) :
     x(0),
     y(0),
     text_duration(0),
-    active_flags(0)
+    active_flags(0),
+    run_ahead_frames(0)
 {}
 
 
@@ -57,17 +59,52 @@ void StatusBar::set_flag(uint16_t flag, bool on)
     }
 
     if (active_flags != old_flags) {
-        std::string flags_string;
+        update_flags_text();
+    }
+}
 
-        if (active_flags & StatusbarFlags::loading) {
-            flags_string.append("[Tape]");
-        }
-        if (active_flags & StatusbarFlags::warp_mode) {
-            flags_string.append("[Warp]");
-        }
 
-        flags_text = flags_string;
+void StatusBar::set_run_ahead(uint8_t frames)
+{
+    run_ahead_frames = frames;
+    update_flags_text();
+}
+
+
+void StatusBar::set_input_latency(uint16_t frames)
+{
+    input_latency = frames;
+    update_flags_text();
+}
+
+
+void StatusBar::update_flags_text()
+{
+    std::string flags_string;
+
+    if (active_flags & StatusbarFlags::loading) {
+        flags_string.append("[Tape]");
+    }
+    if (active_flags & StatusbarFlags::warp_mode) {
+        flags_string.append("[Warp]");
+    }
+    if (active_flags & StatusbarFlags::rewinding) {
+        flags_string.append("[Rewind]");
     }
+    if (active_flags & StatusbarFlags::recording) {
+        flags_string.append("[Rec]");
+    }
+    if (active_flags & StatusbarFlags::playing) {
+        flags_string.append("[Play]");
+    }
+    if (run_ahead_frames > 0) {
+        flags_string.append(std::format("[Run-ahead {}]", run_ahead_frames));
+    }
+    if (input_latency) {
+        flags_string.append(std::format("[Latency {}]", *input_latency));
+    }
+
+    flags_text = flags_string;
 }
 
 
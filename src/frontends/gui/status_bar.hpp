@@ -65,7 +65,24 @@ public:
      */
     void set_flag(uint16_t flag, bool on);
 
+    /**
+     * Set number of run-ahead frames to show. Triggers an update.
+     * @param frames number of run-ahead frames, 0 to hide
+     */
+    void set_run_ahead(uint8_t frames);
+
+    /**
+     * Set last measured input latency to show. Triggers an update.
+     * @param frames input latency in frames
+     */
+    void set_input_latency(uint16_t frames);
+
 private:
+    /**
+     * Rebuild text showing flags and run-ahead info.
+     */
+    void update_flags_text();
+
     uint16_t width;
     uint16_t height;
     uint16_t x;
@@ -75,6 +92,8 @@ private:
     uint16_t text_duration;
 
     uint16_t active_flags;
+    uint8_t run_ahead_frames;
+    std::optional<uint16_t> input_latency;
 
     std::string flags_text;
 };
@@ -28,7 +28,7 @@
 #include "chip/ay3_8912.hpp"
 #include "oric.hpp"
 
-static SDL_Scancode scancode_map[] = {
+static constexpr SDL_Scancode scancode_map[] = {
     SDL_SCANCODE_7,     SDL_SCANCODE_N,     SDL_SCANCODE_5,         SDL_SCANCODE_V,     SDL_SCANCODE_UNKNOWN,   SDL_SCANCODE_1,         SDL_SCANCODE_X,             SDL_SCANCODE_3,
     SDL_SCANCODE_J,     SDL_SCANCODE_T,     SDL_SCANCODE_R,         SDL_SCANCODE_F,     SDL_SCANCODE_UNKNOWN,   SDL_SCANCODE_ESCAPE,    SDL_SCANCODE_Q,             SDL_SCANCODE_D,
     SDL_SCANCODE_M,     SDL_SCANCODE_6,     SDL_SCANCODE_B,         SDL_SCANCODE_4,     SDL_SCANCODE_LCTRL,     SDL_SCANCODE_Z,         SDL_SCANCODE_2,             SDL_SCANCODE_C,
@@ -39,7 +39,16 @@ static SDL_Scancode scancode_map[] = {
     SDL_SCANCODE_8,     SDL_SCANCODE_L,     SDL_SCANCODE_0,         SDL_SCANCODE_SLASH, SDL_SCANCODE_RSHIFT,    SDL_SCANCODE_RETURN,    SDL_SCANCODE_UNKNOWN,       SDL_SCANCODE_EQUALS
 };
 
-std::unordered_map<SDL_Scancode, uint8_t> oric_key_map;
+// Reverse of scancode_map, built once and never changed.
+static const std::unordered_map<SDL_Scancode, uint8_t> oric_key_map = [] {
+    std::unordered_map<SDL_Scancode, uint8_t> key_map;
+    for (uint8_t i = 0; i < 64; ++i) {
+        if (scancode_map[i] != 0) {
+            key_map[scancode_map[i]] = i;
+        }
+    }
+    return key_map;
+}();
 
 
 // ----- Frontend ----------------
@@ -70,12 +79,6 @@ Frontend::Frontend(Oric& oric) :
     sound_audio_stream(nullptr),
     audio_locked(false)
 {
-    for (uint8_t i = 0; i < 64; ++i) {
-        if (scancode_map[i] != 0) {
-            oric_key_map[scancode_map[i]] = i;
-        }
-    }
-
     enable_scanlines = oric.get_config().enable_scanlines() ? 1 : 0;
     enable_vertical_lines = oric.get_config().enable_vertical_lines() ? 1 : 0;
     enable_vignette = oric.get_config().enable_vignette() ? 1 : 0;
@@ -129,7 +132,7 @@ bool Frontend::init_graphics()
         return false;
     }
     SDL_GL_MakeCurrent(sdl_window, gl_context);
-    SDL_GL_SetSwapInterval(1);
+    SDL_GL_SetSwapInterval(oric.get_config().vsync() ? 1 : 0);
 
     if (!load_gl_functions()) {
         BOOST_LOG_TRIVIAL(error) << "Failed to initialize GLAD OpenGL function loader";
@@ -302,8 +305,17 @@ bool Frontend::handle_frame()
                                 oric.get_machine().load_snapshot();
                                 special_pressed = true;
                             }
+
+                            else if (scancode == SDL_SCANCODE_F4) {
+                                oric.get_machine().set_rewinding(true);
+                                special_pressed = true;
+                            }
                         }
                     }
+                    else if (scancode == SDL_SCANCODE_F4) {
+                        oric.get_machine().set_rewinding(false);
+                        special_pressed = true;
+                    }
 
                     if (! special_pressed) {
                         if (!special_pressed) {
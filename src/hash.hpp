@@ -0,0 +1,87 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+constexpr uint64_t fnv1a_64_offset = 0xcbf29ce484222325;
+constexpr uint64_t fnv1a_64_prime = 0x100000001b3;
+
+
+/**
+ * Calculate 64 bit FNV-1a hash of data. Not cryptographic, but fast and stable across
+ * platforms and runs, so hashes can be stored in file names.
+ * @param data data to hash
+ * @param hash hash to continue from, to hash several blocks as one
+ * @return hash value
+ */
+constexpr uint64_t fnv1a_64(std::span<const uint8_t> data, uint64_t hash = fnv1a_64_offset)
+{
+    for (uint8_t b : data) {
+        hash = (hash ^ b) * fnv1a_64_prime;
+    }
+    return hash;
+}
+
+/**
+ * Continue 64 bit FNV-1a hash with the bytes of a value.
+ * @param value value to hash
+ * @param hash hash to continue from
+ * @return hash value
+ */
+template <typename T>
+uint64_t fnv1a_64_value(const T& value, uint64_t hash = fnv1a_64_offset)
+{
+    return fnv1a_64({reinterpret_cast<const uint8_t*>(&value), sizeof(T)}, hash);
+}
+
+/**
+ * Continue 64 bit FNV-1a hash with the bytes of several values.
+ * @param hash hash to continue from
+ * @param values values to hash
+ * @return hash value
+ */
+template <typename... T>
+uint64_t fnv1a_64_values(uint64_t hash, const T&... values)
+{
+    ((hash = fnv1a_64_value(values, hash)), ...);
+    return hash;
+}
+
+/**
+ * Calculate FNV-1a style hash of data, eight bytes at a time. Several times faster than
+ * fnv1a_64 for large blocks, but words are read in host byte order.
+ * @param data data to hash
+ * @param hash hash to continue from
+ * @return hash value
+ */
+inline uint64_t fnv1a_64_words(std::span<const uint8_t> data, uint64_t hash = fnv1a_64_offset)
+{
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * fnv1a_64_prime;
+    }
+    return fnv1a_64(data.subspan(i), hash);
+}
+
+#endif // HASH_H
@@ -15,8 +15,9 @@
 //   along with this program.  If not, see <http://www.gnu.org/licenses/>
 // =========================================================================
 
+#include <algorithm>
+#include <cctype>
 #include <numeric>
-#include <thread>
 
 #include <boost/log/trivial.hpp>
 
@@ -24,10 +25,14 @@
 #include "disk/drive_none.hpp"
 #include "frontends/sdl/frontend.hpp"
 #include "frontends/flags.hpp"
+#include "hash.hpp"
+#include "config.hpp"
 #include "machine.hpp"
 #include "oric.hpp"
+#include "snapshot_file.hpp"
 #include "tape/tape_tap.hpp"
 #include "tape/tape_blank.hpp"
+#include "tape/tape_wav.hpp"
 
 
 // VIA Lines        Oric usage
@@ -47,32 +52,52 @@
 // 19968 cycles per frame / 312 lines = 64 cycles per raster
 constexpr uint8_t cycles_per_raster = 64;
 constexpr uint32_t sound_pause_target = 1000;
+constexpr uint32_t max_latency_probe_frames = 50;
+constexpr uint32_t boot_disk_idle_frames = 50;
+constexpr uint32_t max_boot_frames_factor = 10;
 
 constexpr size_t oric_ram_size = 64*1024;
 constexpr size_t oric_rom_size = 16*1024;
 constexpr size_t disk_rom_size = 8*1024;
 
-using hrc = std::chrono::high_resolution_clock;
-
 using namespace std::chrono_literals;
 
 
-Machine::Machine(Oric& oric) :
+Machine::Machine(const Config& config) :
     cpu(nullptr),
     mos_6522(nullptr),
     ay3(nullptr),
     frontend(nullptr),
     ula(*this, memory, Frontend::texture_width, Frontend::texture_height, Frontend::texture_bpp),
-    oric(oric),
+    config(config),
     monitor(*this, Machine::read_byte),
     memory(oric_ram_size),
-    oric_rom(oric_rom_size),
-    disk_rom(disk_rom_size),
+    oric_rom(std::make_shared<Memory>(oric_rom_size)),
+    disk_rom(std::make_shared<Memory>(disk_rom_size)),
     oric_rom_enabled(true),
     disk_rom_enabled(false),
     tape(nullptr),
+    tape_deadline(0),
+    tape_fast_load(config.tape_fast_load()),
+    tape_traps(config.use_oric1_rom() ? oric1_tape_traps : atmos_tape_traps),
+    tape_auto_warp(config.tape_auto_warp()),
+    auto_warp_active(false),
     disassemble_execution(false),
     cycle_count(0),
+    frame_pacer(config.pacing_mode()),
+    rewind(config.rewind_interval(),
+           config.rewind_keyframe_interval(),
+           config.rewind_buffer_size()),
+    rewinding(false),
+    run_ahead_frames(0),
+    speculative(false),
+    video_enabled(true),
+    total_cycles(0),
+    frame_number(0),
+    latency_probe_active(false),
+    latency_probe_frame(0),
+    latency_probe_hash(0),
+    input_latency(0),
     warpmode_on(false),
     break_exec(false),
     sound_paused(true),
@@ -82,11 +107,14 @@ Machine::Machine(Oric& oric) :
     for (auto& key_row : key_rows) {
         key_row = 0;
     }
+
+    rewind.set_enabled(config.rewind_enabled());
+    run_ahead_frames = std::min(config.run_ahead_frames(), max_run_ahead_frames);
 }
 
 void Machine::reset()
 {
-    frontend->lock_audio();
+    if (frontend) { frontend->lock_audio(); }
     init_ram();
     mos_6522->reset();
     ay3->reset();
@@ -95,9 +123,10 @@ void Machine::reset()
     oric_rom_enabled = !disk_rom_enabled;
 
     tape->reset();
+    tape_deadline = 0;
     cpu->reset();
 
-    frontend->unlock_audio();
+    if (frontend) { frontend->unlock_audio(); }
 }
 
 void Machine::reset_cpu()
@@ -108,6 +137,9 @@ void Machine::reset_cpu()
 void Machine::init(Frontend* frontend)
 {
     this->frontend = frontend;
+    if (frontend) {
+        frontend->get_status_bar().set_run_ahead(run_ahead_frames);
+    }
     init_ram();
     init_cpu();
     init_mos6522();
@@ -116,6 +148,68 @@ void Machine::init(Frontend* frontend)
     init_tape();
 }
 
+std::unique_ptr<Machine> Machine::fork()
+{
+    auto child = std::make_unique<Machine>(config);
+    child->oric_rom = oric_rom;
+    child->disk_rom = disk_rom;
+    child->init_cpu();
+    child->init_mos6522();
+    child->init_ay3();
+    child->disk = disk->fork(*child);
+    child->tape = tape->fork(*child->mos_6522);
+    child->tape_deadline = tape_deadline;
+
+    // Reusing the snapshot makes saving incremental, only RAM pages written since last fork are copied.
+    if (! fork_snapshot) {
+        fork_snapshot = std::make_unique<Snapshot>();
+    }
+    save_snapshot(*fork_snapshot);
+    child->load_snapshot(*fork_snapshot);
+    child->load_keys_from_snapshot(*fork_snapshot);
+    child->current_key_row = current_key_row;
+    child->warpmode_on = warpmode_on;
+    child->auto_warp_active = auto_warp_active;
+
+    return child;
+}
+
+void check_rom_exists(const std::filesystem::path& path)
+{
+    if (! std::filesystem::exists(path)) {
+        throw std::runtime_error(std::format("'{}' does not exist", path.string()));
+    }
+
+    if (! std::filesystem::is_regular_file(path)) {
+        throw std::runtime_error(std::format("'{}' is not a file", path.string()));
+    }
+}
+
+void Machine::load_roms()
+{
+    try {
+        auto path = config.roms_path() / config.rom_name(config.use_oric1_rom() ? RomType::Oric1 : RomType::OricAtmos);
+        check_rom_exists(path);
+        auto rom = std::make_shared<Memory>(oric_rom_size);
+        rom->load(path, 0x0000);
+        oric_rom = std::move(rom);
+    }
+    catch (const std::runtime_error& err) {
+        throw(std::runtime_error(std::format("Failed loading ROM: {}", err.what())));
+    }
+
+    try {
+        auto path = config.roms_path() / config.rom_name(RomType::Microdisk);
+        check_rom_exists(path);
+        auto rom = std::make_shared<Memory>(disk_rom_size);
+        rom->load(path, 0x0000);
+        disk_rom = std::move(rom);
+    }
+    catch (const std::runtime_error& err) {
+        throw(std::runtime_error(std::format("Failed loading disk drive ROM: {}", err.what())));
+    }
+}
+
 void Machine::init_ram()
 {
     // This patten mimics the startup pattern of the Oric RAM.
@@ -129,6 +223,7 @@ void Machine::init_ram()
         std::fill(pos + 128, pos + 256, 0xff);
         pos += 256;
     }
+    memory.mark_all_written();
 }
 
 void Machine::init_cpu()
@@ -176,10 +271,10 @@ void Machine::init_ay3()
 
 void Machine::init_disk()
 {
-    if (! oric.get_config().disk_path().empty()) {
+    if (! config.disk_path().empty()) {
         disk = std::make_unique<DriveMicrodrive>(*this);
 
-        if (!disk->insert_disk(oric.get_config().disk_path())) {
+        if (!disk->insert_disk(config.disk_path())) {
             BOOST_LOG_TRIVIAL(info) << "No disk in drive";
         }
 
@@ -192,12 +287,26 @@ void Machine::init_disk()
     }
 }
 
+/**
+ * Create tape of the type given by the file extension.
+ */
+static std::unique_ptr<Tape> create_tape(MOS6522& via, const std::filesystem::path& path)
+{
+    auto extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), ::tolower);
+    if (extension == ".wav") {
+        return std::make_unique<TapeWav>(via, path);
+    }
+    return std::make_unique<TapeTap>(via, path);
+}
+
 void Machine::init_tape()
 {
-    if (! oric.get_config().tape_path().empty()) {
-        tape = std::make_unique<TapeTap>(*mos_6522, oric.get_config().tape_path());
+    if (! config.tape_path().empty()) {
+        tape = create_tape(*mos_6522, config.tape_path());
+        tape_deadline = 0;
         if (!tape->init()) {
-            exit(1);
+            throw std::runtime_error(std::format("Failed loading tape '{}'", config.tape_path().string()));
         }
     }
     else {
@@ -208,31 +317,133 @@ void Machine::init_tape()
 
 void Machine::run(Oric* oric)
 {
-    uint32_t instructions = 0;
-    next_frame_tp = hrc::now();
+    frame_pacer.restart();
 
     break_exec = false;
-    uint8_t ran = 0;
 
     cycle_count += cycles_per_raster;
 
     while (! break_exec) {
-        if (sound_paused) {
+        // With run-ahead, the shown frame is the last speculative one, not this.
+        const bool do_run_ahead = can_run_ahead();
+        video_enabled = ! do_run_ahead;
+
+        const bool completed = run_frame();
+        video_enabled = true;
+
+        if (! completed) {
+            oric->do_break();
+            return;
+        }
+
+        if (frontend && ! frontend->handle_frame()) {
+            break_exec = true;
+        }
+
+        disk->exec_once_per_frame();
+
+        if (rewinding) {
+            rewind.rewind_frame(*this);
+        }
+        else {
+            rewind.record_frame(*this);
+        }
+
+        if (do_run_ahead) {
+            run_ahead();
+        }
+
+        update_latency_probe();
+
+        if (! warpmode_on) {
+            frame_pacer.wait_for_next_frame(ay3->get_audio_frames_played());
+        }
+    }
+}
+
+void Machine::run_movie_headless()
+{
+    // Warp mode keeps sound register changes from being queued for playback.
+    warpmode_on = true;
+    video_enabled = false;
+
+    while (movie.is_playing()) {
+        if (! run_frame()) {
+            movie.stop(*this);
+            break;
+        }
+        disk->exec_once_per_frame();
+    }
+
+    video_enabled = true;
+}
+
+bool Machine::run_boot(uint32_t frames)
+{
+    video_enabled = false;
+
+    uint32_t idle_frames = 0;
+    for (uint32_t frame = 0; frame < frames * max_boot_frames_factor; frame++) {
+        if (! run_frame()) {
+            video_enabled = true;
+            return false;
+        }
+        disk->exec_once_per_frame();
+
+        idle_frames = disk->is_busy() ? 0 : idle_frames + 1;
+        if (frame + 1 >= frames && idle_frames >= boot_disk_idle_frames) {
+            break;
+        }
+    }
+
+    video_enabled = true;
+    return true;
+}
+
+bool Machine::run_frames(uint32_t frames)
+{
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        video_enabled = frame + 1 == frames;
+        if (! run_frame()) {
+            video_enabled = true;
+            return false;
+        }
+        disk->exec_once_per_frame();
+    }
+
+    video_enabled = true;
+    return true;
+}
+
+bool Machine::run_frame()
+{
+    while (true) {
+        if (sound_paused && ! speculative) {
             sound_pause_counter += 1;
 
             if (sound_pause_counter > sound_pause_target) {
                 sound_paused = false;
-                frontend->pause_sound(false);
+                if (frontend) { frontend->pause_sound(false); }
             }
         }
 
         while (cycle_count > 0) {
+            if (total_cycles >= movie.next_event_cycle() && ! speculative) {
+                movie.apply_events(*this);
+            }
+
+            if (at_tape_trap() && ! speculative) {
+                handle_tape_trap();
+            }
+
             uint8_t cycles = cpu->time_instruction();
-            if (disassemble_execution) {
+            if (disassemble_execution && ! speculative) {
                 PrintStat(cpu->get_current_instruction_addr());
             }
 
-            tape->exec(cycles);
+            if (total_cycles + cycles >= tape_deadline && ! speculative) {
+                tape_deadline = tape->exec(total_cycles + cycles);
+            }
             disk->exec(cycles);
             mos_6522->exec(cycles);
             ay3->exec(cycles);
@@ -242,38 +453,105 @@ void Machine::run(Oric* oric)
             }
 
             if (break_exec) {
-                oric->do_break();
-                return;
+                return false;
             }
 
             cycle_count -= cycles;
+            total_cycles += cycles;
         }
 
-        if (ula.paint_raster()) {
-            next_frame_tp += 20ms;
+        const bool frame_done = ula.paint_raster();
+        cycle_count += cycles_per_raster;
 
-            if (! frontend->handle_frame()) {
-                break_exec = true;
-            }
+        // Frames are counted from the ULA, as run_frame only returns every 25th frame in warp mode.
+        if ((movie.is_active() || state_trace.is_active()) && ula.at_frame_start() && ! speculative) {
+            frame_completed();
+        }
 
-            disk->exec_once_per_frame();
+        if (frame_done) {
+            return true;
+        }
+    }
+}
 
-            hrc::time_point now_tp = hrc::now();
-            if (now_tp > next_frame_tp) {
-                next_frame_tp = now_tp;
-            }
-            else {
-                if (! warpmode_on) {
-                    std::this_thread::sleep_for(next_frame_tp - now_tp);
-                }
-            }
+bool Machine::can_run_ahead() const
+{
+    // Tape and disk contents are not part of snapshots, so can't be rolled back.
+    return run_ahead_frames > 0 && ! warpmode_on && ! rewinding &&
+           ! tape->is_motor_running() && ! disk->is_busy();
+}
+
+void Machine::run_ahead()
+{
+    if (! run_ahead_snapshot) {
+        run_ahead_snapshot = std::make_unique<Snapshot>();
+    }
+
+    // Sound keeps playing from the real frames, only registers are rolled back.
+    save_snapshot(*run_ahead_snapshot, false);
+    const bool stop_requested = break_exec;
+
+    speculative = true;
+    for (uint8_t frame = 1; frame <= run_ahead_frames; frame++) {
+        video_enabled = (frame == run_ahead_frames);
+        if (! run_frame()) {
+            // Hit a break, it will be hit again when running for real.
+            break;
         }
+    }
+    speculative = false;
+    video_enabled = true;
 
-        cycle_count += cycles_per_raster;
+    break_exec = stop_requested;
+    load_snapshot(*run_ahead_snapshot, false);
+}
+
+void Machine::set_run_ahead_frames(uint8_t frames)
+{
+    run_ahead_frames = std::min(frames, max_run_ahead_frames);
+    if (frontend) {
+        frontend->get_status_bar().set_run_ahead(run_ahead_frames);
     }
 }
 
+void Machine::update_latency_probe()
+{
+    if (latency_probe_active) {
+        if (ula.pixel_hash() != latency_probe_hash) {
+            latency_probe_active = false;
+            input_latency = frame_number - latency_probe_frame;
+            if (frontend) {
+                frontend->get_status_bar().set_input_latency(input_latency);
+            }
+        }
+        else if (frame_number - latency_probe_frame > max_latency_probe_frames) {
+            latency_probe_active = false;
+        }
+    }
+
+    frame_number++;
+}
+
 void Machine::key_press(uint8_t key_bits, bool down)
+{
+    // Measure frames until the screen changes after a key press, as input latency.
+    if (down && ! latency_probe_active) {
+        latency_probe_active = true;
+        latency_probe_frame = frame_number;
+        latency_probe_hash = ula.pixel_hash();
+    }
+
+    if (movie.is_playing()) {
+        return;     // Input comes from the recording.
+    }
+    if (movie.is_recording()) {
+        movie.record_key(total_cycles, key_bits, down);
+    }
+
+    set_key(key_bits, down);
+}
+
+void Machine::set_key(uint8_t key_bits, bool down)
 {
     if (down) {
         key_rows[key_bits >> 3] |= (1 << (key_bits & 0x07));
@@ -283,6 +561,64 @@ void Machine::key_press(uint8_t key_bits, bool down)
     }
 }
 
+void Machine::load_keys_from_snapshot(const Snapshot& source)
+{
+    std::copy_n(source.machine.key_rows, std::size(key_rows), key_rows);
+}
+
+StateHashes Machine::state_hashes()
+{
+    return {
+        .cpu = cpu->state_hash(),
+        .via = mos_6522->get_state().hash(),
+        .ay = ay3->state_hash(),
+        .disk = disk->state_hash(),
+        .ula = ula.state_hash(),
+        .memory = memory.hash()
+    };
+}
+
+uint64_t Machine::state_hash()
+{
+    return fnv1a_64_value(total_cycles, state_hashes().combined());
+}
+
+void Machine::frame_completed()
+{
+    const StateHashes hashes = state_hashes();
+
+    if (movie.is_active()) {
+        movie.frame_done(*this, fnv1a_64_value(total_cycles, hashes.combined()));
+    }
+    if (state_trace.is_active()) {
+        state_trace.frame_done(*this, hashes);
+    }
+}
+
+void Machine::handle_tape_trap()
+{
+    if (cpu->PC == tape_traps.write_byte) {
+        tape_recorder.write_byte(cpu->A);
+    }
+    else if (cpu->PC == tape_traps.sync) {
+        if (! tape->fast_sync()) {
+            return;
+        }
+    }
+    else {
+        uint8_t byte;
+        if (! tape->fast_read_byte(byte)) {
+            return;
+        }
+        write_byte(*this, 0x002f, byte);
+        cpu->A = byte;
+        cpu->N_INTERN = cpu->Z_INTERN = byte;
+        cpu->C = false;
+    }
+
+    cpu->return_from_subroutine();
+}
+
 void Machine::update_key_output()
 {
     current_key_row = mos_6522->read_orb() & 0x07;
@@ -304,59 +640,227 @@ void Machine::update_key_output()
 
 void Machine::via_orb_changed(uint8_t orb)
 {
+    if (speculative) {
+        return;     // Tape is not rolled back after run-ahead.
+    }
+
     bool motor_on = orb & 0x40;
+    if (motor_on && tape_recorder.is_active()) {
+        tape_recorder.output_changed(orb & 0x80, total_cycles);
+    }
+
     if (motor_on != tape->is_motor_running()) {
         tape->motor_on(motor_on);
-        frontend->get_status_bar().set_flag(StatusbarFlags::loading, motor_on);
+        tape_deadline = 0;
+        set_status_flag(StatusbarFlags::loading, motor_on);
+
+        // Warp while the motor runs, unless the user has chosen warp mode already.
+        if (tape_auto_warp && motor_on && ! warpmode_on) {
+            auto_warp_active = true;
+            set_warp_mode(true);
+        }
+        else if (! motor_on && auto_warp_active) {
+            auto_warp_active = false;
+            set_warp_mode(false);
+        }
     }
 }
 
 void Machine::save_snapshot()
 {
     if (! snapshot) {
-        snapshot = Snapshot{};
+        snapshot = std::make_unique<Snapshot>();
     }
 
-    cpu->save_to_snapshot(*snapshot);
-    mos_6522->save_to_snapshot(*snapshot);
-    memory.save_to_snapshot(*snapshot);
-    ay3->save_to_snapshot(*snapshot);
-    disk->save_to_snapshot(*snapshot);
+    save_snapshot(*snapshot);
 
-    frontend->get_status_bar().show_text_for("Saved snapshot", std::chrono::seconds(2));
+    show_status_text("Saved snapshot");
 }
 
 void Machine::load_snapshot()
 {
     if (! snapshot) {
-        frontend->get_status_bar().show_text_for("No snapshot saved", 2s);
+        show_status_text("No snapshot saved");
         return;
     }
 
-    cpu->load_from_snapshot(*snapshot);
-    mos_6522->load_from_snapshot(*snapshot);
-    memory.load_from_snapshot(*snapshot);
-    ay3->load_from_snapshot(*snapshot);
-    disk->load_from_snapshot(*snapshot);
+    movie.stop(*this);
+    state_trace.stop();
+
+    load_snapshot(*snapshot);
+
+    show_status_text("Loaded snapshot");
+}
+
+void Machine::save_snapshot(Snapshot& target, bool with_audio)
+{
+    // The audio thread consumes AY register changes, keep it out while saving.
+    if (frontend) { frontend->lock_audio(); }
+
+    target.machine.total_cycles = total_cycles;
+    target.machine.cycle_count = cycle_count;
+    std::copy_n(key_rows, std::size(key_rows), target.machine.key_rows);
+    target.machine.oric_rom_enabled = oric_rom_enabled;
+    target.machine.disk_rom_enabled = disk_rom_enabled;
+
+    cpu->save_to_snapshot(target);
+    mos_6522->save_to_snapshot(target);
+    memory.save_to_snapshot(target);
+    ay3->save_to_snapshot(target, with_audio);
+    disk->save_to_snapshot(target);
+    ula.save_to_snapshot(target);
+
+    if (frontend) { frontend->unlock_audio(); }
+}
+
+void Machine::load_snapshot(Snapshot& source, bool with_audio)
+{
+    if (frontend) { frontend->lock_audio(); }
+
+    total_cycles = source.machine.total_cycles;
+    cycle_count = source.machine.cycle_count;
+    tape_deadline = 0;
+    oric_rom_enabled = source.machine.oric_rom_enabled;
+    disk_rom_enabled = source.machine.disk_rom_enabled;
+
+    cpu->load_from_snapshot(source);
+    mos_6522->load_from_snapshot(source);
+    memory.load_from_snapshot(source);
+    ay3->load_from_snapshot(source, with_audio);
+    disk->load_from_snapshot(source);
+    ula.load_from_snapshot(source);
+
+    if (frontend) { frontend->unlock_audio(); }
+}
+
+void Machine::benchmark_snapshots(uint32_t iterations)
+{
+    using clock = std::chrono::steady_clock;
+
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    auto bench = std::make_unique<Snapshot>();
+
+    auto start_tp = clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        save_snapshot(*bench);
+    }
+    auto saved_tp = clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        load_snapshot(*bench);
+    }
+    auto loaded_tp = clock::now();
+
+    const auto per_iteration = [iterations](clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count() / iterations;
+    };
+
+    std::println("Snapshot size: {} bytes", sizeof(Snapshot));
+    std::println("Save: {:.2f} us, load: {:.2f} us (average of {} iterations)",
+                 per_iteration(saved_tp - start_tp), per_iteration(loaded_tp - saved_tp), iterations);
+}
+
+void Machine::benchmark_boot(uint32_t runs)
+{
+    using clock = std::chrono::steady_clock;
+
+    if (runs == 0) {
+        runs = 1;
+    }
+
+    clock::duration elapsed{};
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < runs; i++) {
+        auto child = fork();
+        child->reset();
+
+        const uint64_t start_cycles = child->total_cycles;
+        auto start_tp = clock::now();
+        if (! child->run_boot(config.boot_frames())) {
+            std::println("Boot stopped at breakpoint, benchmark aborted");
+            return;
+        }
+        elapsed += clock::now() - start_tp;
+        cycles += child->total_cycles - start_cycles;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(elapsed).count() / runs;
+    const double emulated_ms = static_cast<double>(cycles) / runs / 1000.0;
+    std::println("Boot: {:.2f} ms for {:.0f} ms emulated ({:.1f}x real time, average of {} runs)",
+                 ms, emulated_ms, ms > 0 ? emulated_ms / ms : 0.0, runs);
+}
+
+void Machine::save_state_file(const std::filesystem::path& path)
+{
+    auto target = std::make_unique<Snapshot>();
+    save_snapshot(*target);
+    SnapshotFile::save(path, *target, SnapshotFile::crc32(oric_rom->get_memory_vector()));
+}
+
+void Machine::load_state_file(const std::filesystem::path& path)
+{
+    using clock = std::chrono::steady_clock;
+    auto start_tp = clock::now();
+
+    auto source = std::make_unique<Snapshot>();
+    uint32_t rom_crc = SnapshotFile::load(path, *source);
+    if (rom_crc != SnapshotFile::crc32(oric_rom->get_memory_vector())) {
+        BOOST_LOG_TRIVIAL(warning) << "Snapshot " << path.string() << " was saved with a different ROM";
+    }
+
+    movie.stop(*this);
+    state_trace.stop();
+    load_snapshot(*source);
 
-    frontend->get_status_bar().show_text_for("Loaded snapshot", std::chrono::seconds(2));
+    BOOST_LOG_TRIVIAL(info) << "Loaded state from " << path.string() << " in "
+                            << std::chrono::duration<double, std::micro>(clock::now() - start_tp).count() << " us";
+}
+
+void Machine::set_rewinding(bool on)
+{
+    if (on == rewinding || ! rewind.is_enabled()) {
+        return;
+    }
+
+    rewinding = on;
+    if (rewinding) {
+        // Stepping back in time breaks the recorded timeline.
+        movie.stop(*this);
+        state_trace.stop();
+    }
+    else {
+        rewind.stop_rewind();
+    }
+    set_status_flag(StatusbarFlags::rewinding, rewinding);
 }
 
 bool Machine::toggle_warp_mode()
 {
-    warpmode_on = !warpmode_on;
+    auto_warp_active = false;
+    set_warp_mode(! warpmode_on);
+    return warpmode_on;
+}
+
+void Machine::set_warp_mode(bool on)
+{
+    if (on == warpmode_on) {
+        return;
+    }
+
+    warpmode_on = on;
     if (! warpmode_on) {
-        next_frame_tp = hrc::now();
-        frontend->pause_sound(false);
-        frontend->get_status_bar().set_flag(StatusbarFlags::warp_mode, false);
+        frame_pacer.restart();
+        if (frontend) { frontend->pause_sound(false); }
+        set_status_flag(StatusbarFlags::warp_mode, false);
     }
     else {
-        frontend->pause_sound(true);
-        frontend->get_status_bar().set_flag(StatusbarFlags::warp_mode, true);
+        if (frontend) { frontend->pause_sound(true); }
+        set_status_flag(StatusbarFlags::warp_mode, true);
     }
 
     BOOST_LOG_TRIVIAL(info) << "Warp mode: " << (warpmode_on ? "on" : "off");
-    return warpmode_on;
 }
 
 void Machine::insert_tape(std::filesystem::path path)
@@ -365,24 +869,36 @@ void Machine::insert_tape(std::filesystem::path path)
 
     if (! std::filesystem::exists(path)) {
         BOOST_LOG_TRIVIAL(error) << "Tape file not found";
-        frontend->get_status_bar().show_text_for("Tape file not found", 2s);
+        show_status_text("Tape file not found");
         tape = std::make_unique<TapeBlank>();
         return;
     }
 
-    tape = std::make_unique<TapeTap>(*mos_6522, path);
+    tape = create_tape(*mos_6522, path);
+    tape_deadline = 0;
     if (!tape->init()) {
-        frontend->get_status_bar().show_text_for("Failed to load tape", 2s);
+        show_status_text("Failed to load tape");
     }
 
-    frontend->get_status_bar().show_text_for("Tape inserted", 2s);
+    show_status_text("Tape inserted");
 }
 
 void Machine::eject_tape()
 {
     BOOST_LOG_TRIVIAL(info) << "Ejecting tape";
     tape = std::make_unique<TapeBlank>();
-    frontend->get_status_bar().show_text_for("Tape ejected", 2s);
+    show_status_text("Tape ejected");
+}
+
+bool Machine::seek_tape_block(size_t index)
+{
+    if (! tape->seek_block(index)) {
+        return false;
+    }
+    tape_deadline = 0;
+
+    show_status_text(std::format("Tape at file {}: {}", index, tape->get_blocks()[index].name));
+    return true;
 }
 
 void Machine::insert_disk(std::filesystem::path path)
@@ -391,27 +907,41 @@ void Machine::insert_disk(std::filesystem::path path)
 
     if (! std::filesystem::exists(path)) {
         BOOST_LOG_TRIVIAL(error) << "Disk file not found";
-        frontend->get_status_bar().show_text_for("Disk file not found", 2s);
+        show_status_text("Disk file not found");
         return;
     }
 
     disk = std::make_unique<DriveMicrodrive>(*this);
     if (!disk->insert_disk(path)) {
         BOOST_LOG_TRIVIAL(info) << "Failed to load disk image";
-        frontend->get_status_bar().show_text_for("Failed to load disk image", 2s);
+        show_status_text("Failed to load disk image");
         return;
     }
 
     BOOST_LOG_TRIVIAL(info) << "Starting disk drive";
 
-    frontend->get_status_bar().show_text_for("Disk inserted", 2s);
+    show_status_text("Disk inserted");
 }
 
 void Machine::eject_disk()
 {
     BOOST_LOG_TRIVIAL(info) << "Ejecting disk";
     disk = std::make_unique<DriveNone>();
-    frontend->get_status_bar().show_text_for("Disk ejected", 2s);
+    show_status_text("Disk ejected");
+}
+
+void Machine::show_status_text(const std::string& text)
+{
+    if (frontend) {
+        frontend->get_status_bar().show_text_for(text, 2s);
+    }
+}
+
+void Machine::set_status_flag(StatusbarFlags flag, bool on)
+{
+    if (frontend) {
+        frontend->get_status_bar().set_flag(flag, on);
+    }
 }
 
 void Machine::PrintStat()
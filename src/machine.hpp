@@ -21,18 +21,24 @@
 #include <chrono>
 #include <filesystem>
 #include <memory>
-#include <optional>
 
 #include "chip/mos6502.hpp"
 #include "chip/mos6522.hpp"
 #include "chip/ay3_8912.hpp"
 #include "chip/ula.hpp"
+#include "frame_pacer.hpp"
 #include "memory.hpp"
 #include "monitor.hpp"
+#include "movie.hpp"
+#include "rewind.hpp"
 #include "snapshot.hpp"
+#include "state_trace.hpp"
 #include "tape/tape.hpp"
+#include "tape/tape_recorder.hpp"
 #include "disk/drive.hpp"
+#include "frontends/flags.hpp"
 
+class Config;
 class Oric;
 class Frontend;
 class AY3_8912;
@@ -41,7 +47,12 @@ class AY3_8912;
 class Machine
 {
 public:
-    explicit Machine(Oric& oric);
+    /**
+     * Constructor. Machine only depends on the configuration, so several
+     * machines can run in parallel threads in one process.
+     * @param config configuration, must outlive the machine
+     */
+    explicit Machine(const Config& config);
     ~Machine() = default;
 
     /**
@@ -56,9 +67,24 @@ public:
 
     /**
      * Init the machine.
-     * @param frontend pointer to Frontend object
+     * @param frontend pointer to Frontend object, or nullptr to run without graphics and sound
+     */
+    void init(Frontend* frontend = nullptr);
+
+    /**
+     * Create a copy of the machine in its current state, to branch execution from it.
+     * ROMs and tape data are shared, and disk tracks are shared until written. RAM and
+     * chip state are copied. The copy has no frontend, movie or state trace, and can run
+     * in another thread than this machine. Must not be called while this machine is running.
+     * @return new machine
+     */
+    std::unique_ptr<Machine> fork();
+
+    /**
+     * Load Oric and disk drive ROMs from the configured ROM path.
+     * Throws std::runtime_error if a ROM is missing.
      */
-    void init(Frontend* frontend);
+    void load_roms();
 
     /**
      * Init the RAM.
@@ -130,6 +156,33 @@ public:
      */
     void run(uint16_t address, Oric* oric) { cpu->set_pc(address); run(oric); }
 
+    /**
+     * Execute rasters until the ULA has finished a frame.
+     * @return false if execution stopped at a break
+     */
+    bool run_frame();
+
+    /**
+     * Run replay of current movie to its end, as fast as possible and without showing anything.
+     */
+    void run_movie_headless();
+
+    /**
+     * Run boot from reset as fast as possible, without showing anything. Runs at least
+     * the given number of frames, and then until the disk drive has been idle for a while.
+     * @param frames minimum number of frames to run
+     * @return false if execution stopped at a break
+     */
+    bool run_boot(uint32_t frames);
+
+    /**
+     * Run given number of frames as fast as possible, without showing anything.
+     * Only the last frame is painted.
+     * @param frames number of frames to run
+     * @return false if execution stopped at a break
+     */
+    bool run_frames(uint32_t frames);
+
     /**
      * Stop the machine.
      */
@@ -152,6 +205,63 @@ public:
      */
     void key_press(uint8_t key_bits, bool down);
 
+    /**
+     * Set state of key in keyboard matrix, without recording it.
+     * @param key_bits key to set
+     * @param down true if key is pressed
+     */
+    void set_key(uint8_t key_bits, bool down);
+
+    /**
+     * Set keyboard matrix to keys held when snapshot was saved. Not part of loading a
+     * snapshot, to not leave keys stuck that are no longer held.
+     * @param source snapshot to get keys from
+     */
+    void load_keys_from_snapshot(const Snapshot& source);
+
+    /**
+     * Calculate hashes of the state of each chip and of memory.
+     * @return state hashes
+     */
+    StateHashes state_hashes();
+
+    /**
+     * Calculate hash of whole machine state and cycle count, to detect divergence between
+     * runs that should be identical.
+     * @return state hash
+     */
+    uint64_t state_hash();
+
+    /**
+     * Get state hash trace.
+     * @return reference to state trace
+     */
+    StateTrace& get_state_trace() { return state_trace; }
+
+    /**
+     * Get recorder of tape output.
+     * @return reference to tape recorder
+     */
+    TapeRecorder& get_tape_recorder() { return tape_recorder; }
+
+    /**
+     * Get configuration the machine was created with.
+     * @return reference to configuration
+     */
+    const Config& get_config() const { return config; }
+
+    /**
+     * Get input recorder and player.
+     * @return reference to movie
+     */
+    Movie& get_movie() { return movie; }
+
+    /**
+     * Get video chip.
+     * @return reference to ULA
+     */
+    const ULA& get_ula() const { return ula; }
+
     /**
      * Update key output to other circuits.
      */
@@ -174,14 +284,80 @@ public:
     void load_snapshot();
 
     /**
-     * Toggle warp mode on and off.
+     * Save state of whole machine to given snapshot.
+     * @param target snapshot to save to
+     * @param with_audio true to include sound generation state
+     */
+    void save_snapshot(Snapshot& target, bool with_audio = true);
+
+    /**
+     * Load state of whole machine from given snapshot.
+     * @param source snapshot to load from
+     * @param with_audio true to restore sound generation state, false to leave sound playing
+     */
+    void load_snapshot(Snapshot& source, bool with_audio = true);
+
+    /**
+     * Measure and print time taken to save and load snapshots.
+     * @param iterations number of saves and loads to average over
+     */
+    void benchmark_snapshots(uint32_t iterations);
+
+    /**
+     * Measure and print time taken to boot from reset until the disk is idle. Each run
+     * boots a fork of the machine, so the running machine and disk image are left untouched.
+     * @param runs number of boots to average over
+     */
+    void benchmark_boot(uint32_t runs);
+
+    /**
+     * Save state of whole machine to file.
+     * @param path path of file to write
+     * @throws std::runtime_error if the file could not be written
+     */
+    void save_state_file(const std::filesystem::path& path);
+
+    /**
+     * Load state of whole machine from file.
+     * @param path path of file to read
+     * @throws std::runtime_error if the file could not be read or is not valid
+     */
+    void load_state_file(const std::filesystem::path& path);
+
+    /**
+     * Toggle warp mode on and off. Takes over from automatic warp during tape loading.
      * @return true if warp mode is on
      */
     bool toggle_warp_mode();
 
+    /**
+     * Set warp mode. Sound is paused while in warp mode.
+     * @param on true to enable warp mode
+     */
+    void set_warp_mode(bool on);
+
     void insert_tape(std::filesystem::path path);
     void eject_tape();
 
+    /**
+     * Get current tape.
+     * @return reference to tape
+     */
+    Tape& get_tape() { return *tape; }
+
+    /**
+     * Get current disk image.
+     * @return pointer to disk image, nullptr if no disk is inserted
+     */
+    DiskImage* get_disk_image() { return disk->get_disk_image(); }
+
+    /**
+     * Position the tape at the start of a file, to load it without playing earlier files.
+     * @param index index of block in tape directory
+     * @return true if the tape was positioned
+     */
+    bool seek_tape_block(size_t index);
+
     void insert_disk(std::filesystem::path path);
     void eject_disk();
 
@@ -194,6 +370,42 @@ public:
         disassemble_execution = disassemble;
     }
 
+    /**
+     * Get frame pacer.
+     * @return reference to frame pacer
+     */
+    FramePacer& get_frame_pacer() { return frame_pacer; }
+
+    /**
+     * Start or stop stepping backwards through rewind history.
+     * @param on true to start rewinding
+     */
+    void set_rewinding(bool on);
+
+    /**
+     * Get rewind history.
+     * @return reference to rewind history
+     */
+    Rewind& get_rewind() { return rewind; }
+
+    /**
+     * Set number of frames to run ahead each frame, to reduce input latency.
+     * @param frames number of frames, 0 to disable
+     */
+    void set_run_ahead_frames(uint8_t frames);
+
+    /**
+     * Get number of frames to run ahead each frame.
+     * @return number of run-ahead frames
+     */
+    uint8_t get_run_ahead_frames() const { return run_ahead_frames; }
+
+    /**
+     * Get last measured input latency, frames from key press until screen changed.
+     * @return input latency in frames
+     */
+    uint32_t get_input_latency() const { return input_latency; }
+
     /**
      * Print CPU status.
      */
@@ -205,12 +417,12 @@ public:
     {
         if (!machine.oric_rom_enabled) {
             if (machine.disk_rom_enabled && address >= 0xe000) {
-                return machine.disk_rom.mem[address - 0xe000];
+                return machine.disk_rom->mem[address - 0xe000];
             }
         }
         else {
             if (address >= 0xc000) {
-                return machine.oric_rom.mem[address - 0xc000];
+                return machine.oric_rom->mem[address - 0xc000];
             }
         }
 
@@ -263,6 +475,7 @@ public:
             return;
         }
 
+        machine.memory.mark_written(address);
         machine.memory.mem[address] = val;
     }
 
@@ -271,6 +484,7 @@ public:
         if (address > 0x00ff) {
             return;
         }
+        machine.memory.mark_written(address);
         machine.memory.mem[address] = val;
     }
 
@@ -305,31 +519,114 @@ public:
 
     bool break_exec;
     Memory memory;
-    Memory oric_rom;
-    Memory disk_rom;
+    std::shared_ptr<Memory> oric_rom;   // ROMs are shared with forked machines.
+    std::shared_ptr<Memory> disk_rom;
     bool oric_rom_enabled;
     bool disk_rom_enabled;
 
     Frontend* frontend;
     bool warpmode_on;
+    bool speculative;       // Running run-ahead frames that will be thrown away.
+    bool video_enabled;
+    uint64_t total_cycles;  // Emulated cycles since start, never reset.
 
 protected:
+    /**
+     * Entry points of the ROM tape routines that are replaced when fast loading.
+     */
+    struct TapeRomTraps {
+        uint16_t sync;          // Wait for sync bytes and the $24 marker.
+        uint16_t read_byte;     // Read one byte to A and $2F.
+        uint16_t write_byte;    // Write byte in A.
+    };
+
+    static constexpr TapeRomTraps oric1_tape_traps{0xe696, 0xe630, 0xe5f5};
+    static constexpr TapeRomTraps atmos_tape_traps{0xe735, 0xe6c9, 0xe65e};
+
+    /**
+     * Check if the CPU is at the entry of a replaced ROM tape routine.
+     * @return true if fast load should handle the current instruction
+     */
+    bool at_tape_trap() const
+    {
+        return tape_fast_load && oric_rom_enabled &&
+               (cpu->PC == tape_traps.read_byte || cpu->PC == tape_traps.sync ||
+                (cpu->PC == tape_traps.write_byte && tape_recorder.is_active()));
+    }
+
+    /**
+     * Run the ROM tape routine at the current address by reading directly from the tape image,
+     * or writing directly to the tape recorder. If the tape can't provide data the routine runs
+     * normally, using bit level tape emulation.
+     */
+    void handle_tape_trap();
+
     /**
      * Print status and instruction at given address.
      * @param address
      */
     void PrintStat(uint16_t address);
 
+    /**
+     * Check if run-ahead can be used for next frame.
+     * @return true if run-ahead can be used
+     */
+    bool can_run_ahead() const;
+
+    /**
+     * Run and show run-ahead frames, then return to current state.
+     */
+    void run_ahead();
+
+    /**
+     * Check if the screen has changed since a key was pressed, once per frame.
+     */
+    void update_latency_probe();
+
+    /**
+     * Called at the end of each emulated frame while recording or verifying.
+     */
+    void frame_completed();
+
+    /**
+     * Show text in the status bar, if there is a frontend.
+     * @param text text to show
+     */
+    void show_status_text(const std::string& text);
+
+    /**
+     * Set or clear a status bar flag, if there is a frontend.
+     * @param flag flag to change
+     * @param on true to set flag
+     */
+    void set_status_flag(StatusbarFlags flag, bool on);
+
     ULA ula;
-    Oric& oric;
+    const Config& config;
     Monitor monitor;
 
     std::unique_ptr<Drive> disk;
     std::unique_ptr<Tape> tape;
+    uint64_t tape_deadline;     // Cycle when the tape must run next, 0 to run it right away.
+    bool tape_fast_load;
+    TapeRomTraps tape_traps;
+    bool tape_auto_warp;
+    bool auto_warp_active;  // Warp mode was turned on by the tape motor, not the user.
 
     bool disassemble_execution;
     int32_t cycle_count;
-    std::chrono::high_resolution_clock::time_point next_frame_tp;
+    FramePacer frame_pacer;
+    Rewind rewind;
+    bool rewinding;
+
+    uint8_t run_ahead_frames;
+    std::unique_ptr<Snapshot> run_ahead_snapshot;
+
+    uint32_t frame_number;
+    bool latency_probe_active;
+    uint32_t latency_probe_frame;
+    uint64_t latency_probe_hash;
+    uint32_t input_latency;
 
     bool sound_paused;
     uint32_t sound_pause_counter;
@@ -337,7 +634,11 @@ protected:
     uint8_t current_key_row;
     uint8_t key_rows[8];
 
-    std::optional<Snapshot> snapshot;
+    std::unique_ptr<Snapshot> snapshot;
+    std::unique_ptr<Snapshot> fork_snapshot;
+    Movie movie;
+    StateTrace state_trace;
+    TapeRecorder tape_recorder;
 };
 
 #endif // MACHINE_H
@@ -88,6 +88,57 @@ int main(int argc, char *argv[])
     }
 
     oric->get_machine().reset_cpu();
+
+    if (! config.load_state().empty()) {
+        if (! oric->load_state(config.load_state())) {
+            return 3;
+        }
+    }
+    else if (config.play_movie_path().empty()) {
+        oric->boot();
+    }
+
+    auto& machine = oric->get_machine();
+    if (! config.play_movie_path().empty()) {
+        try {
+            machine.get_movie().start_playback(config.play_movie_path(), machine);
+        }
+        catch (const std::exception &err) {
+            std::println("Error replaying movie: {}", err.what());
+            return 3;
+        }
+    }
+    else if (! config.record_movie_path().empty()) {
+        machine.get_movie().start_recording(config.record_movie_path(), machine);
+    }
+
+    try {
+        if (! config.record_trace_path().empty()) {
+            machine.get_state_trace().start_recording(config.record_trace_path());
+        }
+        else if (! config.verify_trace_path().empty()) {
+            machine.get_state_trace().start_verifying(config.verify_trace_path());
+        }
+    }
+    catch (const std::exception &err) {
+        std::println("Error starting state trace: {}", err.what());
+        return 3;
+    }
+
+    if (! config.record_tape_path().empty()) {
+        try {
+            machine.get_tape_recorder().start_recording(config.record_tape_path());
+        }
+        catch (const std::exception &err) {
+            std::println("Error recording tape: {}", err.what());
+            return 3;
+        }
+    }
+
+    if (config.headless()) {
+        return oric->run_headless();
+    }
+
     oric->run();
 
     return 0;
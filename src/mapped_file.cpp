@@ -0,0 +1,162 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+
+MappedFile::MappedFile() :
+    mapped(nullptr),
+    mapped_size(0),
+    mode(Mode::ReadOnly)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::open(const std::filesystem::path& path, Mode mode)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), mode == Mode::ReadWrite ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error(std::format("could not read file: {}", path.string()));
+    }
+
+    const int protection = mode == Mode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* result = mmap(nullptr, st.st_size, protection, mode == Mode::ReadWrite ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (result == MAP_FAILED) {
+        throw std::runtime_error(std::format("could not map file: {}", path.string()));
+    }
+
+    mapped = static_cast<uint8_t*>(result);
+    mapped_size = st.st_size;
+#else
+    const DWORD access = mode == Mode::ReadWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+    HANDLE file = CreateFileW(path.c_str(), access, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+
+    LARGE_INTEGER file_size{};
+    if (! GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error(std::format("could not read file: {}", path.string()));
+    }
+
+    // The view keeps the file mapping alive after its handles are closed.
+    const DWORD protection = mode == Mode::ReadWrite ? PAGE_READWRITE :
+                             mode == Mode::CopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY;
+    HANDLE mapping = CreateFileMappingW(file, nullptr, protection, 0, 0, nullptr);
+    CloseHandle(file);
+    if (! mapping) {
+        throw std::runtime_error(std::format("could not map file: {}", path.string()));
+    }
+
+    const DWORD view_access = mode == Mode::ReadWrite ? FILE_MAP_WRITE :
+                              mode == Mode::CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ;
+    void* result = MapViewOfFile(mapping, view_access, 0, 0, 0);
+    CloseHandle(mapping);
+    if (! result) {
+        throw std::runtime_error(std::format("could not map file: {}", path.string()));
+    }
+
+    mapped = static_cast<uint8_t*>(result);
+    mapped_size = file_size.QuadPart;
+#endif
+    this->mode = mode;
+}
+
+void MappedFile::close()
+{
+    if (! mapped) {
+        return;
+    }
+
+#ifndef _WIN32
+    munmap(mapped, mapped_size);
+#else
+    UnmapViewOfFile(mapped);
+#endif
+    mapped = nullptr;
+    mapped_size = 0;
+    mode = Mode::ReadOnly;
+}
+
+void MappedFile::advise_sequential()
+{
+#ifndef _WIN32
+    if (mapped) {
+        madvise(mapped, mapped_size, MADV_SEQUENTIAL);
+    }
+#endif
+}
+
+void MappedFile::release(size_t offset, size_t length)
+{
+#ifndef _WIN32
+    // Only whole pages inside the range can be released.
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t start = (offset + page_size - 1) / page_size * page_size;
+    const size_t end = std::min(offset + length, mapped_size) / page_size * page_size;
+    if (mapped && mode == Mode::ReadOnly && start < end) {
+        madvise(mapped + start, end - start, MADV_DONTNEED);
+    }
+#endif
+}
+
+bool MappedFile::sync(size_t offset, size_t length)
+{
+    if (! mapped || mode != Mode::ReadWrite || offset >= mapped_size) {
+        return true;
+    }
+    length = std::min(length, mapped_size - offset);
+
+#ifndef _WIN32
+    // msync needs a page aligned start.
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t start = offset / page_size * page_size;
+    return msync(mapped + start, offset + length - start, MS_SYNC) == 0;
+#else
+    return FlushViewOfFile(mapped + offset, length) != 0;
+#endif
+}
@@ -0,0 +1,96 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+/**
+ * Memory mapping of a whole file. Pages are loaded by the operating system when read,
+ * so even very large files only use memory for the parts in use.
+ */
+class MappedFile
+{
+public:
+    enum class Mode
+    {
+        ReadOnly,       // Mapping can only be read.
+        ReadWrite,      // Writes to the mapping are written to the file, see sync().
+        CopyOnWrite     // Writes to the mapping are kept in memory, the file is never changed.
+    };
+
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Map file.
+     * @param path path of file to map
+     * @param mode how the mapping may be written to
+     * @throws std::runtime_error if the file could not be mapped
+     */
+    void open(const std::filesystem::path& path, Mode mode = Mode::ReadOnly);
+
+    /**
+     * Unmap file.
+     */
+    void close();
+
+    const uint8_t* data() const { return mapped; }
+    size_t size() const { return mapped_size; }
+
+    /**
+     * Get writable mapping.
+     * @return mapped data, nullptr if the file was opened read-only
+     */
+    uint8_t* writable_data() { return mode == Mode::ReadOnly ? nullptr : mapped; }
+
+    /**
+     * Write changes in the given range to the file and wait until done. Only does
+     * anything for files opened with Mode::ReadWrite.
+     * @param offset start of range
+     * @param length length of range
+     * @return false if writing failed
+     */
+    bool sync(size_t offset, size_t length);
+
+    /**
+     * Hint that the file will be read from start to end.
+     */
+    void advise_sequential();
+
+    /**
+     * Hint that the given range will not be read again soon, so its pages can be dropped.
+     * Ignored for writable mappings, where dropping pages could lose changes.
+     * @param offset start of range
+     * @param length length of range
+     */
+    void release(size_t offset, size_t length);
+
+protected:
+    uint8_t* mapped;
+    size_t mapped_size;
+    Mode mode;
+};
+
+#endif // MAPPED_FILE_H
@@ -15,14 +15,17 @@
 //   along with this program.  If not, see <http://www.gnu.org/licenses/>
 // =========================================================================
 
+#include <algorithm>
 #include <boost/log/trivial.hpp>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <print>
+#include <random>
 #include <stdexcept>
 #include <sstream>
 
+#include "hash.hpp"
 #include "memory.hpp"
 #include "snapshot.hpp"
 
@@ -31,10 +34,15 @@ Memory::Memory(size_t size) :
     mem(nullptr),
     size(size),
     mempos(0),
-    memory(size)
+    memory(size),
+    id(0),
+    epoch(1),
+    page_hashes_epoch(0),
+    page_hashes_valid(false)
 {
     mem = memory.data();
     std::fill(memory.begin(), memory.end(), 0x00);
+    mark_all_written();
 }
 
 
@@ -58,18 +66,85 @@ void Memory::load(const std::filesystem::path& path, uint32_t address)
     }
 
     in.read(reinterpret_cast<char *>(mem + address), file_size);
+    mark_range_written(address, file_size);
+}
+
+
+void Memory::mark_range_written(uint32_t address, uint32_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    const uint32_t last = std::min<uint32_t>((address + length - 1) / page_size, max_pages - 1);
+    for (uint32_t page = address / page_size; page <= last; page++) {
+        page_epochs[page] = epoch;
+    }
+}
+
+
+void Memory::mark_all_written()
+{
+    page_epochs.fill(epoch);
 }
 
 
 void Memory::save_to_snapshot(Snapshot& snapshot)
 {
-    snapshot.memory = memory;
+    const uint32_t pages = std::min<size_t>(size, snapshot.memory.size()) / page_size;
+
+    if (id == 0) {
+        // Random, so that snapshots from other memories or processes never match. Made on first
+        // use, as random_device is slow and most memories (ROMs, short-lived forks) never need one.
+        std::random_device rd;
+        id = (static_cast<uint64_t>(rd()) << 32) | rd() | 1;
+    }
+
+    if (snapshot.memory_id == id) {
+        // Snapshot was saved from this memory before, only copy pages written since.
+        for (uint32_t page = 0; page < pages; page++) {
+            if (page_written_since(page, snapshot.memory_epoch)) {
+                std::copy_n(mem + page * page_size, page_size, snapshot.memory.begin() + page * page_size);
+            }
+        }
+    }
+    else {
+        std::copy_n(mem, pages * page_size, snapshot.memory.begin());
+    }
+
+    snapshot.memory_id = id;
+    snapshot.memory_epoch = next_epoch();
 }
 
 
 void Memory::load_from_snapshot(Snapshot& snapshot)
 {
-    memory = snapshot.memory;
+    const uint32_t pages = std::min<size_t>(size, snapshot.memory.size()) / page_size;
+    const bool incremental = (id != 0 && snapshot.memory_id == id);
+
+    // Pages not written since snapshot was saved are still equal to the snapshot.
+    for (uint32_t page = 0; page < pages; page++) {
+        if (! incremental || page_written_since(page, snapshot.memory_epoch)) {
+            std::copy_n(snapshot.memory.begin() + page * page_size, page_size, mem + page * page_size);
+            page_epochs[page] = epoch;
+        }
+    }
+}
+
+
+uint64_t Memory::hash()
+{
+    const uint32_t pages = std::min<uint32_t>(size / page_size, max_pages);
+
+    for (uint32_t page = 0; page < pages; page++) {
+        if (! page_hashes_valid || page_written_since(page, page_hashes_epoch)) {
+            page_hashes[page] = fnv1a_64_words({mem + page * page_size, page_size});
+        }
+    }
+    page_hashes_valid = true;
+    page_hashes_epoch = next_epoch();
+
+    return fnv1a_64_words({reinterpret_cast<const uint8_t*>(page_hashes.data()), pages * sizeof(uint64_t)});
 }
 
 
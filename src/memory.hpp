@@ -18,6 +18,7 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <array>
 #include <filesystem>
 #include <cstdint>
 #include <vector>
@@ -26,9 +27,17 @@
 class Snapshot;
 
 
+/**
+ * A block of memory. Writes are tracked per 256 byte page, by storing the current
+ * write epoch for each written page. A new epoch is started each time a snapshot is
+ * saved, which makes it possible to copy only pages written since a given snapshot.
+ */
 class Memory
 {
 public:
+    static constexpr uint32_t page_size = 256;
+    static constexpr uint32_t max_pages = 256;
+
     explicit Memory(size_t size);
     ~Memory() = default;
 
@@ -57,6 +66,46 @@ public:
      */
     void load_from_snapshot(Snapshot& snapshot);
 
+    /**
+     * Mark page containing address as written. Must be called for all writes to mem
+     * that bypass the Memory functions.
+     * @param address written address
+     */
+    void mark_written(uint16_t address) { page_epochs[address >> 8] = epoch; }
+
+    /**
+     * Mark all pages in an address range as written.
+     * @param address start address
+     * @param length number of bytes
+     */
+    void mark_range_written(uint32_t address, uint32_t length);
+
+    /**
+     * Mark all pages as written.
+     */
+    void mark_all_written();
+
+    /**
+     * Check if a page has been written after given epoch.
+     * @param page page number
+     * @param since epoch to compare with
+     * @return true if page was written after epoch since
+     */
+    bool page_written_since(uint8_t page, uint32_t since) const { return page_epochs[page] > since; }
+
+    /**
+     * Start new write epoch.
+     * @return epoch that just ended, pages written after it will compare greater
+     */
+    uint32_t next_epoch() { return epoch++; }
+
+    /**
+     * Calculate hash of memory contents. Hashes are kept per page, and only pages
+     * written since last call are hashed again.
+     * @return hash of memory contents
+     */
+    uint64_t hash();
+
     /**
      * Set position of memory for later use of << operator.
      * @param address new memory position
@@ -70,6 +119,7 @@ public:
      * @return Memory
      */
     friend Memory& operator<<(Memory& os, unsigned int in) {
+        os.mark_written(os.mempos);
         os.mem[os.mempos++] = static_cast<uint8_t>(in & 0xff);
         return os;
     }
@@ -90,6 +140,14 @@ protected:
     uint32_t size;
     uint32_t mempos;
     std::vector<uint8_t> memory;
+
+    uint64_t id;                                    // Identifies this memory in snapshots, 0 until first saved.
+    uint32_t epoch;
+    std::array<uint32_t, max_pages> page_epochs;
+
+    std::array<uint64_t, max_pages> page_hashes;
+    uint32_t page_hashes_epoch;                     // Write epoch when page_hashes were updated.
+    bool page_hashes_valid;
 };
 
 
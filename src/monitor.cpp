@@ -24,7 +24,7 @@
 #include "monitor.hpp"
 
 
-std::vector<Opcode> opcodes_list = {
+const std::vector<Opcode> opcodes_list = {
         {ADC_IMM,   "ADC", Addressing::immediate},
         {ADC_ZP,    "ADC", Addressing::zero_page},
         {ADC_ZP_X,  "ADC", Addressing::zero_page_indexed_x},
@@ -236,13 +236,20 @@ std::vector<Opcode> opcodes_list = {
 };
 
 
+// Opcodes by opcode byte, built once and shared by all monitors.
+static const std::map<uint8_t, Opcode> opcodes = [] {
+    std::map<uint8_t, Opcode> opcode_map;
+    for (auto& opcode : opcodes_list) {
+        opcode_map[opcode.opcode] = opcode;
+    }
+    return opcode_map;
+}();
+
+
 Monitor::Monitor(Machine& machine, f_memory_read_byte_handler&& read_byte_handler) :
     machine(machine),
     memory_read_byte_handler(read_byte_handler)
 {
-    for (auto& opcode : opcodes_list) {
-        opcodes[opcode.opcode] = opcode;
-    }
 }
 
 
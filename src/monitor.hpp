@@ -75,8 +75,6 @@ public:
 private:
     Machine& machine;
     f_memory_read_byte_handler memory_read_byte_handler;
-
-    std::map<uint8_t, Opcode> opcodes;
 };
 
 
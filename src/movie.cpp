@@ -0,0 +1,250 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/log/trivial.hpp>
+
+#include "frontends/flags.hpp"
+#include "frontends/sdl/frontend.hpp"
+#include "machine.hpp"
+#include "movie.hpp"
+#include "snapshot_file.hpp"
+
+constexpr uint64_t no_event = std::numeric_limits<uint64_t>::max();
+
+
+Movie::Movie() :
+    mode(Mode::Idle),
+    start(std::make_unique<Snapshot>()),
+    rom_crc(0),
+    event_index(0),
+    frame_index(0),
+    next_cycle(no_event),
+    last_replay_verified(false)
+{
+}
+
+void Movie::start_recording(const std::filesystem::path& path, Machine& machine)
+{
+    stop(machine);
+
+    this->path = path;
+    events.clear();
+    frame_hashes.clear();
+
+    start->memory_id = 0;
+    machine.save_snapshot(*start);
+    rom_crc = SnapshotFile::crc32(machine.oric_rom->get_memory_vector());
+
+    mode = Mode::Recording;
+    if (machine.frontend) {
+        machine.frontend->get_status_bar().set_flag(StatusbarFlags::recording, true);
+    }
+    std::println("Recording input to {}", path.string());
+}
+
+void Movie::start_playback(const std::filesystem::path& path, Machine& machine)
+{
+    stop(machine);
+
+    std::ifstream file(path, std::ios::binary);
+    if (! file) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    FileHeader header;
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("file too short for movie header");
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("not an Auric movie file");
+    }
+    if (header.version != version) {
+        throw std::runtime_error(std::format("unsupported movie version {} (expected {})", header.version, version));
+    }
+
+    const size_t events_size = size_t(header.event_count) * sizeof(Event);
+    const size_t hashes_size = size_t(header.frame_count) * sizeof(uint64_t);
+    if (data.size() != sizeof(header) + header.snapshot_size + events_size + hashes_size) {
+        throw std::runtime_error("movie file has wrong size");
+    }
+
+    size_t pos = sizeof(header);
+    uint32_t movie_rom_crc = SnapshotFile::read({data.data() + pos, header.snapshot_size}, *start);
+    pos += header.snapshot_size;
+
+    events.resize(header.event_count);
+    std::memcpy(events.data(), data.data() + pos, events_size);
+    pos += events_size;
+
+    frame_hashes.resize(header.frame_count);
+    std::memcpy(frame_hashes.data(), data.data() + pos, hashes_size);
+
+    if (movie_rom_crc != SnapshotFile::crc32(machine.oric_rom->get_memory_vector())) {
+        BOOST_LOG_TRIVIAL(warning) << "Movie " << path.string() << " was recorded with a different ROM";
+    }
+
+    machine.load_snapshot(*start);
+    machine.load_keys_from_snapshot(*start);
+
+    this->path = path;
+    event_index = 0;
+    frame_index = 0;
+    next_cycle = events.empty() ? no_event : events[0].cycle;
+    last_replay_verified = false;
+
+    mode = Mode::Playing;
+    if (machine.frontend) {
+        machine.frontend->get_status_bar().set_flag(StatusbarFlags::playing, true);
+    }
+    std::println("Replaying {} ({} frames, {} key events)", path.string(), frame_hashes.size(), events.size());
+}
+
+void Movie::stop(Machine& machine)
+{
+    if (mode == Mode::Recording) {
+        mode = Mode::Idle;
+        if (machine.frontend) {
+            machine.frontend->get_status_bar().set_flag(StatusbarFlags::recording, false);
+        }
+
+        try {
+            save();
+            std::println("Saved recording of {} frames and {} key events to {}",
+                         frame_hashes.size(), events.size(), path.string());
+        }
+        catch (const std::exception& err) {
+            std::println("Failed saving recording to {}: {}", path.string(), err.what());
+        }
+    }
+    else if (mode == Mode::Playing) {
+        finish_playback(machine, false);
+    }
+}
+
+void Movie::record_key(uint64_t cycle, uint8_t key_bits, bool down)
+{
+    Event event{};
+    event.cycle = cycle;
+    event.key_bits = key_bits;
+    event.down = down ? 1 : 0;
+    events.push_back(event);
+}
+
+void Movie::apply_events(Machine& machine)
+{
+    while (event_index < events.size() && events[event_index].cycle <= machine.total_cycles) {
+        const auto& event = events[event_index++];
+        machine.set_key(event.key_bits, event.down);
+    }
+    next_cycle = (event_index < events.size()) ? events[event_index].cycle : no_event;
+}
+
+void Movie::frame_done(Machine& machine, uint64_t state_hash)
+{
+    if (mode == Mode::Recording) {
+        frame_hashes.push_back(state_hash);
+        return;
+    }
+
+    if (frame_index >= frame_hashes.size()) {
+        finish_playback(machine, true);
+        return;
+    }
+
+    if (state_hash != frame_hashes[frame_index]) {
+        std::println("Replay diverged from recording at frame {} (cycle {})", frame_index, machine.total_cycles);
+        finish_playback(machine, false);
+        return;
+    }
+
+    frame_index++;
+    if (frame_index == frame_hashes.size()) {
+        finish_playback(machine, true);
+    }
+}
+
+void Movie::print_status() const
+{
+    switch (mode) {
+        case Mode::Idle:
+            std::println("No recording or replay active");
+            break;
+        case Mode::Recording:
+            std::println("Recording to {}: {} frames, {} key events",
+                         path.string(), frame_hashes.size(), events.size());
+            break;
+        case Mode::Playing:
+            std::println("Replaying {}: frame {} of {}, key event {} of {}",
+                         path.string(), frame_index, frame_hashes.size(), event_index, events.size());
+            break;
+    }
+}
+
+void Movie::save() const
+{
+    std::ostringstream snapshot_data;
+    SnapshotFile::write(snapshot_data, *start, rom_crc);
+    const std::string snapshot_bytes = snapshot_data.str();
+
+    FileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.snapshot_size = snapshot_bytes.size();
+    header.event_count = events.size();
+    header.frame_count = frame_hashes.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (! file) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(snapshot_bytes.data(), snapshot_bytes.size());
+    file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(Event));
+    file.write(reinterpret_cast<const char*>(frame_hashes.data()), frame_hashes.size() * sizeof(uint64_t));
+
+    if (! file) {
+        throw std::runtime_error(std::format("could not write file: {}", path.string()));
+    }
+}
+
+void Movie::finish_playback(Machine& machine, bool completed)
+{
+    mode = Mode::Idle;
+    next_cycle = no_event;
+    last_replay_verified = completed;
+
+    if (machine.frontend) {
+        machine.frontend->get_status_bar().set_flag(StatusbarFlags::playing, false);
+    }
+
+    if (completed) {
+        std::println("Replay of {} frames verified", frame_index);
+    }
+    else {
+        std::println("Replay stopped after {} of {} frames", frame_index, frame_hashes.size());
+    }
+}
@@ -0,0 +1,161 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "snapshot.hpp"
+
+class Machine;
+
+
+/**
+ * Records and replays keyboard input ("movies").
+ *
+ * A recording holds a snapshot of the machine when recording started, every key press
+ * and release stamped with the emulated cycle it happened at, and a hash of the machine
+ * state at the end of each frame. Replaying restores the snapshot and injects the keys
+ * at exactly the same cycles, so emulation follows the recording bit for bit. The frame
+ * hashes are used to verify that it does.
+ *
+ * Tape and disk contents are not part of the recording, so replays that use them need
+ * the same media in the same position.
+ */
+class Movie
+{
+public:
+    static constexpr char magic[8] = {'A', 'U', 'R', 'I', 'C', 'M', 'O', 'V'};
+    static constexpr uint16_t version = 2;
+
+    Movie();
+
+    /**
+     * Start recording from current machine state.
+     * @param path path of file to write when recording stops
+     * @param machine machine to record
+     */
+    void start_recording(const std::filesystem::path& path, Machine& machine);
+
+    /**
+     * Load recording from file and start replaying it, restoring the starting state.
+     * @param path path of file to replay
+     * @param machine machine to replay on
+     * @throws std::runtime_error if the file could not be read or is not valid
+     */
+    void start_playback(const std::filesystem::path& path, Machine& machine);
+
+    /**
+     * Stop recording or replay. A recording is written to file.
+     * @param machine machine recorded on
+     */
+    void stop(Machine& machine);
+
+    bool is_recording() const { return mode == Mode::Recording; }
+    bool is_playing() const { return mode == Mode::Playing; }
+    bool is_active() const { return mode != Mode::Idle; }
+
+    /**
+     * Check if the last replay ran to its end with all frames matching the recording.
+     * @return true if last replay was verified
+     */
+    bool verified() const { return last_replay_verified; }
+
+    /**
+     * Log a key event while recording.
+     * @param cycle emulated cycle of event
+     * @param key_bits key that changed
+     * @param down true if key was pressed
+     */
+    void record_key(uint64_t cycle, uint8_t key_bits, bool down);
+
+    /**
+     * Return cycle of the next key event to replay.
+     * @return cycle of next event, max value if none
+     */
+    uint64_t next_event_cycle() const { return next_cycle; }
+
+    /**
+     * Inject all key events due at current cycle.
+     * @param machine machine to inject into
+     */
+    void apply_events(Machine& machine);
+
+    /**
+     * Called at the end of each emulated frame, to record or verify the state hash.
+     * @param machine machine recorded or replayed
+     * @param state_hash hash of machine state at end of frame
+     */
+    void frame_done(Machine& machine, uint64_t state_hash);
+
+    /**
+     * Print recording or replay status to console.
+     */
+    void print_status() const;
+
+protected:
+    enum class Mode { Idle, Recording, Playing };
+
+    struct Event
+    {
+        uint64_t cycle;
+        uint8_t key_bits;
+        uint8_t down;
+        uint8_t reserved[6];
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t snapshot_size;
+        uint32_t event_count;
+        uint32_t frame_count;
+    };
+
+    /**
+     * Write recording to file.
+     */
+    void save() const;
+
+    /**
+     * Stop replaying and report the result.
+     * @param machine machine replayed on
+     * @param completed true if all recorded frames were replayed
+     */
+    void finish_playback(Machine& machine, bool completed);
+
+    Mode mode;
+    std::filesystem::path path;
+    std::unique_ptr<Snapshot> start;
+    uint32_t rom_crc;
+    std::vector<Event> events;
+    std::vector<uint64_t> frame_hashes;
+
+    size_t event_index;
+    size_t frame_index;
+    uint64_t next_cycle;
+    bool last_replay_verified;
+};
+
+#endif // MOVIE_H
@@ -16,7 +16,10 @@
 // =========================================================================
 
 
+#include <algorithm>
+#include <chrono>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <print>
 #include <sstream>
@@ -29,11 +32,17 @@
 #include <boost/algorithm/string.hpp>
 
 #include "oric.hpp"
+#include "hash.hpp"
 #include "memory.hpp"
+#include "disk/disk_image.hpp"
 #include "frontends/sdl/frontend.hpp"
+#include "mapped_file.hpp"
+#include "snapshot_file.hpp"
 
 namespace po = boost::program_options;
 
+constexpr const char* default_state_slot = "quick";
+
 
 Oric::Oric(Config& config) :
     config(config),
@@ -51,60 +60,31 @@ Oric::~Oric()
 {
 }
 
-void check_rom_exists(std::filesystem::path path)
+void Oric::init()
 {
-    if (! std::filesystem::exists(path)) {
-        throw std::runtime_error(std::format("'{}' does not exist", path.string()));
-    }
+    machine = std::make_unique<Machine>(config);
 
-    if (! std::filesystem::is_regular_file(path)) {
-        throw std::runtime_error(std::format("'{}' is not a file", path.string()));
+    // Headless runs have no window or sound, the machine runs without a frontend.
+    if (! config.headless()) {
+        frontend = std::make_unique<Frontend>(*this);
     }
-}
-
-void Oric::init()
-{
-    machine = std::make_unique<Machine>(*this);
-    frontend = std::make_unique<Frontend>(*this);
 
     machine->init(frontend.get());
 
-    try {
-        if (config.use_oric1_rom()) {
-            auto path = config.roms_path() / config.rom_name(RomType::Oric1);
-            check_rom_exists(path);
-            machine->oric_rom.load(path, 0x0000);
-        }
-        else {
-            auto path = config.roms_path() / config.rom_name(RomType::OricAtmos);
-            check_rom_exists(path);
-            machine->oric_rom.load(path, 0x0000);
-        }
-    }
-    catch (const std::runtime_error& err) {
-        throw(std::runtime_error(std::format("Failed loading ROM: {}", err.what())));
-    }
+    machine->load_roms();
 
-    try {
-        auto path = config.roms_path() / config.rom_name(RomType::Microdisk);
-        check_rom_exists(path);
-        machine->disk_rom.load(path, 0x0000);
+    if (frontend) {
+        frontend->init_graphics();
+        frontend->init_sound();
+        frontend->get_status_bar().show_text_for("Starting Auric!", std::chrono::seconds(3));
     }
-    catch (const std::runtime_error& err) {
-        throw(std::runtime_error(std::format("Failed loading disk drive ROM: {}", err.what())));
-    }
-
-    frontend->init_graphics();
-    frontend->init_sound();
-
-    frontend->get_status_bar().show_text_for("Starting Auric!", std::chrono::seconds(3));
 
     machine->set_disassemble_execution(false);
 }
 
 void Oric::init_machine()
 {
-    machine = std::make_unique<Machine>(*this);
+    machine = std::make_unique<Machine>(config);
 }
 
 void Oric::run()
@@ -134,9 +114,32 @@ void Oric::run()
                 break;
         }
     }
+    machine->get_movie().stop(*machine);
+    machine->get_state_trace().stop();
     frontend->close_sound();
 }
 
+int Oric::run_headless()
+{
+    using clock = std::chrono::steady_clock;
+    auto start_tp = clock::now();
+    uint64_t start_cycles = machine->total_cycles;
+
+    machine->run_movie_headless();
+
+    const double seconds = std::chrono::duration<double>(clock::now() - start_tp).count();
+    const double emulated_seconds = (machine->total_cycles - start_cycles) / 1000000.0;
+    std::println("Emulated {:.1f} s in {:.2f} s ({:.0f}x real time)",
+                 emulated_seconds, seconds, seconds > 0 ? emulated_seconds / seconds : 0.0);
+
+    // A state trace being verified must have been verified to its end as well.
+    const bool verifying = ! config.verify_trace_path().empty();
+    StateTrace& state_trace = machine->get_state_trace();
+    state_trace.stop();
+
+    return (machine->get_movie().verified() && (! verifying || state_trace.verified())) ? 0 : 1;
+}
+
 
 void Oric::do_break()
 {
@@ -164,6 +167,152 @@ void Oric::do_quit()
     state = STATE_QUIT;
 }
 
+std::filesystem::path Oric::state_path(const std::string& name) const
+{
+    std::filesystem::path path(name);
+    if (path.has_extension() || path.has_parent_path()) {
+        return path;
+    }
+    return config.snapshots_path() / (name + SnapshotFile::extension);
+}
+
+/**
+ * Continue hash with the size and contents of a file. A missing file hashes as empty.
+ * @param path path of file
+ * @param hash hash to continue from
+ * @return hash value
+ */
+static uint64_t hash_file(const std::filesystem::path& path, uint64_t hash)
+{
+    MappedFile file;
+    try {
+        file.open(path);
+    }
+    catch (const std::runtime_error&) {
+        return fnv1a_64_value(size_t{0}, hash);
+    }
+    return fnv1a_64_words({file.data(), file.size()}, fnv1a_64_value(file.size(), hash));
+}
+
+std::filesystem::path Oric::boot_cache_path() const
+{
+    uint64_t key = fnv1a_64_value(SnapshotFile::version);
+    key = fnv1a_64_value(sizeof(Snapshot), key);
+    key = fnv1a_64_value(config.use_oric1_rom(), key);
+    key = fnv1a_64_value(config.boot_frames(), key);
+    key = fnv1a_64(machine->oric_rom->get_memory_vector(), key);
+
+    // Disk ROM and disk contents only matter when there is a disk to boot from.
+    if (! config.disk_path().empty()) {
+        key = fnv1a_64(machine->disk_rom->get_memory_vector(), key);
+        key = hash_file(config.disk_path(), key);
+
+        // The overlay changes what is booted, and fast transfers change boot timing.
+        key = fnv1a_64_values(key, config.disk_overlay(), config.disk_fast_transfer());
+        if (config.disk_overlay() == DiskOverlay::File && machine->get_disk_image()) {
+            key = hash_file(machine->get_disk_image()->overlay_path(), key);
+        }
+    }
+
+    return config.snapshots_path() / "boot" / std::format("{:016x}{}", key, SnapshotFile::extension);
+}
+
+void Oric::boot()
+{
+    if (! config.boot_cache_enabled() || config.cold_boot() || config.start_in_monitor()) {
+        return;
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto start_tp = clock::now();
+    auto path = boot_cache_path();
+
+    if (std::filesystem::exists(path)) {
+        try {
+            machine->load_state_file(path);
+            return;
+        }
+        catch (const std::exception& err) {
+            BOOST_LOG_TRIVIAL(warning) << "Ignoring boot cache " << path.string() << ": " << err.what();
+        }
+    }
+
+    if (! machine->run_boot(config.boot_frames())) {
+        return;     // Stopped at a breakpoint, leave it to the monitor.
+    }
+
+    try {
+        std::filesystem::create_directories(path.parent_path());
+        machine->save_state_file(path);
+    }
+    catch (const std::exception& err) {
+        BOOST_LOG_TRIVIAL(warning) << "Failed saving boot cache " << path.string() << ": " << err.what();
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Booted and cached boot state in "
+                            << std::chrono::duration<double, std::milli>(clock::now() - start_tp).count() << " ms";
+}
+
+bool Oric::save_state(const std::string& name)
+{
+    auto path = state_path(name);
+    try {
+        if (path.has_parent_path()) {
+            std::filesystem::create_directories(path.parent_path());
+        }
+        machine->save_state_file(path);
+    }
+    catch (const std::exception& err) {
+        std::println("Failed saving state to {}: {}", path.string(), err.what());
+        return false;
+    }
+
+    std::println("Saved state to {}", path.string());
+    if (frontend) {
+        frontend->get_status_bar().show_text_for(std::format("Saved state '{}'", name), std::chrono::seconds(2));
+    }
+    return true;
+}
+
+bool Oric::load_state(const std::string& name)
+{
+    auto path = state_path(name);
+    try {
+        machine->load_state_file(path);
+    }
+    catch (const std::exception& err) {
+        std::println("Failed loading state from {}: {}", path.string(), err.what());
+        return false;
+    }
+
+    if (frontend) {
+        frontend->get_status_bar().show_text_for(std::format("Loaded state '{}'", name), std::chrono::seconds(2));
+    }
+    return true;
+}
+
+void Oric::list_states() const
+{
+    std::error_code ec;
+    std::vector<std::string> slots;
+    for (const auto& entry : std::filesystem::directory_iterator(config.snapshots_path(), ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == SnapshotFile::extension) {
+            slots.push_back(entry.path().stem().string());
+        }
+    }
+
+    if (slots.empty()) {
+        std::println("No saved snapshot slots in {}", config.snapshots_path().string());
+        return;
+    }
+
+    std::ranges::sort(slots);
+    for (const auto& slot : slots) {
+        std::println("  {}", slot);
+    }
+}
+
 
 uint16_t Oric::string_to_word(std::string& addr)
 {
@@ -198,16 +347,37 @@ Oric::State Oric::handle_command(std::string& command_line)
         std::println("d               : disassemble from last address or PC");
         std::println("d <address> <n> : disassemble from address and n bytes ahead (example: d c000 10)");
         std::println("debug           : show debug output at run time");
+        std::println("disk            : print disk image and overlay status");
+        std::println("disk save       : write disk overlay to overlay file");
+        std::println("disk discard    : drop disk overlay and its file, read image file again");
+        std::println("disk merge      : write disk overlay into image file, then drop it");
+        std::println("ft [r]          : print frame time histogram (r: reset statistics)");
         std::println("g               : go (continue)");
         std::println("g <address>     : go to address and run (example: g 1f00)");
         std::println("h               : help (showing this text)");
         std::println("i               : print machine info");
         std::println("m <address> <n> : dump memory from address and n bytes ahead (example: m 1f00 20)");
+        std::println("mp <file>       : replay keyboard input from movie file");
+        std::println("mr <file>       : record keyboard input to movie file");
+        std::println("ms              : stop recording or replay, print status if none active");
         std::println("pc <address>    : set program counter to address");
         std::println("quiet           : prevent debug output at run time");
+        std::println("ra [n]          : print or set number of run-ahead frames (0 disables)");
+        std::println("rw [c]          : print rewind history status (c: clear history)");
         std::println("q               : quit");
         std::println("s [n]           : step one or possible n steps");
+        std::println("sb [n]          : benchmark snapshot save and load, n iterations (default 1000)");
+        std::println("bb [n]          : benchmark boot until disk is idle, n runs (default 5)");
+        std::println("sl [slot]       : load state from snapshot slot or file (default slot: quick)");
+        std::println("slots           : list saved snapshot slots");
+        std::println("ss [slot]       : save state to snapshot slot or file (default slot: quick)");
         std::println("sr, softreset   : soft reset oric");
+        std::println("tape [n]        : list files on tape, or position tape at file n");
+        std::println("tape rec <file> : record tape output (CSAVE) to TAP file");
+        std::println("tape stop       : stop recording tape output");
+        std::println("tr <file>       : record per-frame state hashes to trace file");
+        std::println("ts              : stop state trace, print status if none active");
+        std::println("tv <file>       : verify per-frame state hashes against trace file");
         std::println("v               : print VIA (6522) info\n");
         return STATE_MON;
     }
@@ -238,6 +408,14 @@ Oric::State Oric::handle_command(std::string& command_line)
         machine->set_disassemble_execution(true);
         std::println("Debug mode enabled");
     }
+    else if (cmd == "ft") { // frame times
+        if (parts.size() > 1 && parts[1] == "r") {
+            machine->get_frame_pacer().reset_histogram();
+            std::println("Frame time statistics reset");
+            return STATE_MON;
+        }
+        machine->get_frame_pacer().print_histogram();
+    }
     else if (cmd == "g") { // go <address>
         return STATE_RUN;
     }
@@ -252,6 +430,32 @@ Oric::State Oric::handle_command(std::string& command_line)
         }
         machine->memory.show(string_to_word(parts[1]), string_to_word(parts[2]));
     }
+    else if (cmd == "mp") { // movie play
+        if (parts.size() < 2) {
+            std::println("Use: mp <file>");
+            return STATE_MON;
+        }
+        try {
+            machine->get_movie().start_playback(parts[1], *machine);
+        }
+        catch (const std::exception& err) {
+            std::println("Failed replaying {}: {}", parts[1], err.what());
+        }
+    }
+    else if (cmd == "mr") { // movie record
+        if (parts.size() < 2) {
+            std::println("Use: mr <file>");
+            return STATE_MON;
+        }
+        machine->get_movie().start_recording(parts[1], *machine);
+    }
+    else if (cmd == "ms") { // movie stop
+        if (! machine->get_movie().is_active()) {
+            machine->get_movie().print_status();
+            return STATE_MON;
+        }
+        machine->get_movie().stop(*machine);
+    }
     else if (cmd == "pc") { // set pc
         if (parts.size() < 2) {
             std::println("Error: missing address");
@@ -269,6 +473,21 @@ Oric::State Oric::handle_command(std::string& command_line)
         machine->set_disassemble_execution(false);
         std::println("Quiet mode enabled");
     }
+    else if (cmd == "ra") { // run-ahead
+        if (parts.size() > 1) {
+            machine->set_run_ahead_frames(static_cast<uint8_t>(std::clamp<unsigned long>(std::stoul(parts[1]), 0, max_run_ahead_frames)));
+        }
+        std::println("Run-ahead: {} frames, last measured input latency: {} frames",
+                     machine->get_run_ahead_frames(), machine->get_input_latency());
+    }
+    else if (cmd == "rw") { // rewind
+        if (parts.size() > 1 && parts[1] == "c") {
+            machine->get_rewind().clear();
+            std::println("Rewind history cleared");
+            return STATE_MON;
+        }
+        machine->get_rewind().print_status();
+    }
     else if (cmd == "s") { // step
         if (parts.size() == 2) {
             machine->run(std::stol(parts[1]), this);
@@ -282,10 +501,117 @@ Oric::State Oric::handle_command(std::string& command_line)
         }
         machine->PrintStat();
     }
+    else if (cmd == "bb") { // boot benchmark
+        uint32_t runs = (parts.size() > 1) ? std::stoul(parts[1]) : 5;
+        machine->benchmark_boot(runs);
+    }
+    else if (cmd == "sb") { // snapshot benchmark
+        uint32_t iterations = (parts.size() > 1) ? std::stoul(parts[1]) : 1000;
+        machine->benchmark_snapshots(iterations);
+    }
+    else if (cmd == "sl") { // load state
+        load_state(parts.size() > 1 ? parts[1] : default_state_slot);
+    }
+    else if (cmd == "slots") {
+        list_states();
+    }
+    else if (cmd == "ss") { // save state
+        save_state(parts.size() > 1 ? parts[1] : default_state_slot);
+    }
     else if (cmd == "sr" || cmd == "softreset") {
         machine->cpu->NMI();
         std::println("NMI triggered");
     }
+    else if (cmd == "disk") {
+        auto* image = machine->get_disk_image();
+        if (! image) {
+            std::println("No disk inserted");
+            return STATE_MON;
+        }
+
+        const std::string action = parts.size() > 1 ? parts[1] : "";
+        if (! action.empty() && image->overlay_mode() == DiskOverlay::None) {
+            std::println("Disk has no overlay, changes are written to the image file");
+            return STATE_MON;
+        }
+
+        if (action == "save") {
+            image->save_overlay();
+        }
+        else if (action == "discard" || action == "merge") {
+            if (action == "discard") {
+                image->discard_overlay();
+            }
+            else if (! image->merge_overlay()) {
+                std::println("Failed writing overlay to disk image");
+                return STATE_MON;
+            }
+            // Insert the disk again to read the image without the overlay.
+            const auto path = image->path();
+            machine->insert_disk(path);
+            image = machine->get_disk_image();
+            if (! image) {
+                return STATE_MON;
+            }
+        }
+        else if (! action.empty()) {
+            std::println("Use: disk [save|discard|merge]");
+            return STATE_MON;
+        }
+        image->print_stat();
+    }
+    else if (cmd == "tape") {
+        if (parts.size() > 1 && parts[1] == "rec") {
+            if (parts.size() < 3) {
+                std::println("Use: tape rec <file>");
+                return STATE_MON;
+            }
+            try {
+                machine->get_tape_recorder().start_recording(parts[2]);
+            }
+            catch (const std::exception& err) {
+                std::println("Failed recording tape: {}", err.what());
+            }
+            return STATE_MON;
+        }
+        if (parts.size() > 1 && parts[1] == "stop") {
+            machine->get_tape_recorder().stop();
+            return STATE_MON;
+        }
+        if (parts.size() > 1) {
+            const size_t index = std::stoul(parts[1]);
+            if (! machine->seek_tape_block(index)) {
+                std::println("No file {} on tape", index);
+                return STATE_MON;
+            }
+        }
+        machine->get_tape().print_stat();
+        machine->get_tape_recorder().print_status();
+    }
+    else if (cmd == "tr" || cmd == "tv") { // state trace record / verify
+        if (parts.size() < 2) {
+            std::println("Use: {} <file>", cmd);
+            return STATE_MON;
+        }
+        try {
+            if (cmd == "tr") {
+                machine->get_state_trace().start_recording(parts[1]);
+            }
+            else {
+                machine->get_state_trace().start_verifying(parts[1]);
+            }
+        }
+        catch (const std::exception& err) {
+            std::println("Failed starting state trace: {}", err.what());
+        }
+    }
+    else if (cmd == "ts") { // state trace stop
+        if (! machine->get_state_trace().is_active()) {
+            machine->get_state_trace().print_status();
+            return STATE_MON;
+        }
+        machine->get_state_trace().stop();
+    }
     else if (cmd == "v") { // info
         machine->mos_6522->get_state().print();
     }
@@ -72,6 +72,12 @@ public:
      */
     void run();
 
+    /**
+     * Run Oric without window or sound, as fast as possible, until movie replay ends.
+     * @return 0 if replay was verified, 1 if not
+     */
+    int run_headless();
+
     /**
      * Break Oric.
      */
@@ -82,10 +88,48 @@ public:
      */
     void do_quit();
 
+    /**
+     * Bring machine from reset to booted state. Restores cached boot state if there is one
+     * for current ROMs, disk image and settings, else boots and caches the result.
+     */
+    void boot();
+
+    /**
+     * Save machine state to snapshot slot or file.
+     * @param name slot name, or path to file if it has an extension or directory part
+     * @return true on success
+     */
+    bool save_state(const std::string& name);
+
+    /**
+     * Load machine state from snapshot slot or file.
+     * @param name slot name, or path to file if it has an extension or directory part
+     * @return true on success
+     */
+    bool load_state(const std::string& name);
+
+    /**
+     * Print saved snapshot slots to console.
+     */
+    void list_states() const;
+
+    /**
+     * Return path of cached boot state for current ROMs, disk image and settings.
+     * @return path to boot cache file
+     */
+    std::filesystem::path boot_cache_path() const;
+
 protected:
     State handle_command(std::string& command_line);
     uint16_t string_to_word(std::string& addr);
 
+    /**
+     * Return file path for snapshot slot name or file.
+     * @param name slot name, or path to file
+     * @return path to snapshot file
+     */
+    std::filesystem::path state_path(const std::string& name) const;
+
     Config& config;
     State state;
     std::unique_ptr<Frontend> frontend;
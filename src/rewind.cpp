@@ -0,0 +1,306 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <algorithm>
+#include <cstring>
+#include <print>
+
+#include <boost/log/trivial.hpp>
+
+#include "machine.hpp"
+#include "rewind.hpp"
+
+constexpr size_t max_run_length = 0xffff;
+constexpr size_t min_zero_run = 4;          // Shorter zero runs are cheaper to store as literals.
+constexpr double frame_time_us = 20000.0;
+
+
+Rewind::Rewind(uint32_t interval, uint32_t keyframe_interval, size_t max_bytes) :
+    interval(std::max<uint32_t>(interval, 1)),
+    keyframe_interval(std::max<uint32_t>(keyframe_interval, 1)),
+    // Room for at least one keyframe group of uncompressed snapshots, or nothing could be rewound.
+    max_bytes(std::max(max_bytes, size_t(this->keyframe_interval) * sizeof(Snapshot))),
+    enabled(true),
+    total_bytes(0),
+    frame_counter(0),
+    entries_since_keyframe(0),
+    force_keyframe(true),
+    current(nullptr),
+    keyframe(nullptr),
+    restored(nullptr),
+    has_restored(false),
+    record_time(0),
+    recorded_count(0),
+    frame_count(0)
+{
+}
+
+void Rewind::set_enabled(bool enabled)
+{
+    this->enabled = enabled;
+    clear();
+}
+
+void Rewind::record_frame(Machine& machine)
+{
+    if (! enabled) {
+        return;
+    }
+
+    frame_count++;
+    if (++frame_counter < interval) {
+        return;
+    }
+    frame_counter = 0;
+
+    auto start_tp = std::chrono::steady_clock::now();
+
+    // Allocated on first use, machines that never run interactively never need them.
+    if (! current) {
+        current = std::make_unique<Snapshot>();
+        keyframe = std::make_unique<Snapshot>();
+    }
+    machine.save_snapshot(*current);
+
+    Entry entry;
+    if (force_keyframe || entries_since_keyframe >= keyframe_interval) {
+        entry.keyframe = true;
+        encode(nullptr, *current, nullptr, entry.data);
+        std::swap(keyframe, current);
+        entries_since_keyframe = 0;
+        force_keyframe = false;
+    }
+    else {
+        entry.keyframe = false;
+
+        // Pages not written since the keyframe was saved are equal, no need to compare them.
+        PageSet clean_pages;
+        if (keyframe->memory_id == current->memory_id) {
+            for (uint32_t page = 0; page < Memory::max_pages; page++) {
+                clean_pages[page] = ! machine.memory.page_written_since(page, keyframe->memory_epoch);
+            }
+        }
+        encode(keyframe.get(), *current, &clean_pages, entry.data);
+    }
+    entries_since_keyframe++;
+
+    entry.data.shrink_to_fit();
+    total_bytes += entry.data.size();
+    entries.push_back(std::move(entry));
+    evict();
+
+    record_time += std::chrono::steady_clock::now() - start_tp;
+    recorded_count++;
+}
+
+bool Rewind::rewind_frame(Machine& machine)
+{
+    if (! enabled) {
+        return false;
+    }
+
+    if (++frame_counter >= interval || ! has_restored) {
+        frame_counter = 0;
+
+        if (! entries.empty()) {
+            if (! restored) {
+                restored = std::make_unique<Snapshot>();
+            }
+            restore_entry(entries.size() - 1, *restored);
+            has_restored = true;
+
+            total_bytes -= entries.back().data.size();
+            entries.pop_back();
+        }
+    }
+
+    if (! has_restored) {
+        return false;
+    }
+
+    // Hold the restored state until next step back, instead of letting the machine run forward.
+    machine.load_snapshot(*restored);
+    return ! entries.empty();
+}
+
+void Rewind::stop_rewind()
+{
+    has_restored = false;
+    frame_counter = 0;
+    force_keyframe = true;
+}
+
+void Rewind::clear()
+{
+    entries.clear();
+    total_bytes = 0;
+    frame_counter = 0;
+    entries_since_keyframe = 0;
+    force_keyframe = true;
+    has_restored = false;
+}
+
+void Rewind::print_status() const
+{
+    const double seconds = static_cast<double>(entries.size()) * interval / 50.0;
+    std::println("Rewind: {}", enabled ? "enabled" : "disabled");
+    std::println("  History: {} entries, {:.1f} s, {:.2f} MB of {:.2f} MB",
+                 entries.size(), seconds, total_bytes / (1024.0 * 1024.0), max_bytes / (1024.0 * 1024.0));
+
+    if (recorded_count > 0 && frame_count > 0) {
+        const double record_us = std::chrono::duration<double, std::micro>(record_time).count();
+        const double per_frame_us = record_us / frame_count;
+        std::println("  Recording: {:.1f} us per snapshot, {:.2f} us per frame ({:.3f}% of frame time)",
+                     record_us / recorded_count, per_frame_us, 100.0 * per_frame_us / frame_time_us);
+    }
+}
+
+void Rewind::encode(const Snapshot* base, const Snapshot& target, const PageSet* clean_pages,
+                    std::vector<uint8_t>& out)
+{
+    const auto* t = reinterpret_cast<const uint8_t*>(&target);
+    const auto* b = base ? reinterpret_cast<const uint8_t*>(base) : nullptr;
+    constexpr size_t size = sizeof(Snapshot);
+    const size_t memory_offset = target.memory.data() - t;
+
+    // Returns number of bytes left in memory page at position, if the page is clean.
+    auto clean_bytes = [clean_pages, memory_offset](size_t i) -> size_t {
+        if (! clean_pages || i < memory_offset || i >= memory_offset + snapshot_memory_size) {
+            return 0;
+        }
+        const size_t offset = i - memory_offset;
+        return (*clean_pages)[offset / Memory::page_size] ? Memory::page_size - (offset % Memory::page_size) : 0;
+    };
+
+    auto diff = [t, b](size_t i) -> uint8_t { return b ? t[i] ^ b[i] : t[i]; };
+    auto diff_word = [t, b](size_t i) -> uint64_t {
+        uint64_t tw;
+        std::memcpy(&tw, t + i, sizeof(tw));
+        if (! b) { return tw; }
+        uint64_t bw;
+        std::memcpy(&bw, b + i, sizeof(bw));
+        return tw ^ bw;
+    };
+
+    out.clear();
+    out.reserve(1024);
+
+    size_t pos = 0;
+    while (pos < size) {
+        // Skip unchanged bytes, a clean page or a word at a time where possible.
+        size_t zeros = 0;
+        while (pos + zeros < size) {
+            const size_t i = pos + zeros;
+            if (const size_t clean = clean_bytes(i); clean > 0 && zeros + clean <= max_run_length) {
+                zeros += clean;
+            }
+            else if (i + 8 <= size && zeros + 8 <= max_run_length && diff_word(i) == 0) {
+                zeros += 8;
+            }
+            else if (zeros < max_run_length && diff(i) == 0) {
+                zeros++;
+            }
+            else {
+                break;
+            }
+        }
+        pos += zeros;
+
+        // Collect changed bytes until a long enough unchanged run.
+        const size_t start = pos;
+        while (pos < size && pos - start < max_run_length) {
+            if (diff(pos) == 0) {
+                size_t run = 1;
+                while (run < min_zero_run && pos + run < size && diff(pos + run) == 0) {
+                    run++;
+                }
+                if (run >= min_zero_run || pos + run == size) {
+                    break;
+                }
+                pos = std::min(pos + run, start + max_run_length);
+                continue;
+            }
+            pos++;
+        }
+        const size_t literals = pos - start;
+
+        out.push_back(zeros & 0xff);
+        out.push_back(zeros >> 8);
+        out.push_back(literals & 0xff);
+        out.push_back(literals >> 8);
+        for (size_t i = start; i < pos; i++) {
+            out.push_back(diff(i));
+        }
+    }
+}
+
+void Rewind::decode(std::span<const uint8_t> data, Snapshot& target)
+{
+    auto* t = reinterpret_cast<uint8_t*>(&target);
+    constexpr size_t size = sizeof(Snapshot);
+
+    size_t pos = 0;
+    size_t i = 0;
+    while (i + 4 <= data.size()) {
+        const size_t zeros = data[i] | (data[i + 1] << 8);
+        const size_t literals = data[i + 2] | (data[i + 3] << 8);
+        i += 4;
+
+        pos += zeros;
+        if (pos + literals > size || i + literals > data.size()) {
+            BOOST_LOG_TRIVIAL(error) << "Rewind: corrupt history entry";
+            return;
+        }
+
+        for (size_t n = 0; n < literals; n++) {
+            t[pos++] ^= data[i++];
+        }
+    }
+}
+
+void Rewind::restore_entry(size_t index, Snapshot& target) const
+{
+    size_t key_index = index;
+    while (key_index > 0 && ! entries[key_index].keyframe) {
+        key_index--;
+    }
+
+    std::memset(&target, 0, sizeof(Snapshot));
+    decode(entries[key_index].data, target);
+
+    if (key_index != index) {
+        decode(entries[index].data, target);
+    }
+}
+
+void Rewind::evict()
+{
+    // Drop whole keyframe groups, their deltas are useless without them. The newest group
+    // is always kept, even if larger than max_bytes, so that the latest frames can be rewound.
+    while (total_bytes > max_bytes && entries.size() > 1) {
+        auto next_keyframe = std::find_if(entries.begin() + 1, entries.end(),
+                                          [](const Entry& entry) { return entry.keyframe; });
+        if (next_keyframe == entries.end()) {
+            break;
+        }
+
+        for (auto count = next_keyframe - entries.begin(); count > 0; --count) {
+            total_bytes -= entries.front().data.size();
+            entries.pop_front();
+        }
+    }
+}
@@ -0,0 +1,154 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "memory.hpp"
+#include "snapshot.hpp"
+
+class Machine;
+
+
+/**
+ * Keeps a bounded history of machine snapshots, to be able to step backwards in time.
+ *
+ * A snapshot is recorded every `interval` frames. Every `keyframe_interval` entry is a
+ * keyframe, the rest are stored as the XOR difference against the latest keyframe. Both
+ * are run length encoded, so unchanged memory takes almost no space.
+ */
+class Rewind
+{
+public:
+    /**
+     * Constructor.
+     * @param interval number of frames between recorded snapshots
+     * @param keyframe_interval number of recorded snapshots per keyframe
+     * @param max_bytes maximum number of bytes to use for history, raised to fit at least one keyframe group
+     */
+    Rewind(uint32_t interval, uint32_t keyframe_interval, size_t max_bytes);
+
+    /**
+     * Enable or disable recording. Disabling clears all history.
+     * @param enabled true to enable recording
+     */
+    void set_enabled(bool enabled);
+
+    /**
+     * Check if recording is enabled.
+     * @return true if recording is enabled
+     */
+    bool is_enabled() const { return enabled; }
+
+    /**
+     * Called once per frame while running normally. Records a snapshot every interval frames.
+     * @param machine machine to record
+     */
+    void record_frame(Machine& machine);
+
+    /**
+     * Called once per frame while rewinding. Steps back one recorded snapshot every
+     * interval frames, so that history plays back at real time speed.
+     * @param machine machine to restore
+     * @return false if there is no more history
+     */
+    bool rewind_frame(Machine& machine);
+
+    /**
+     * Called when rewinding stops. Recording continues from the restored state.
+     */
+    void stop_rewind();
+
+    /**
+     * Remove all recorded history.
+     */
+    void clear();
+
+    /**
+     * Print history size and recording overhead to console.
+     */
+    void print_status() const;
+
+protected:
+    struct Entry
+    {
+        bool keyframe;
+        std::vector<uint8_t> data;
+    };
+
+    using PageSet = std::bitset<Memory::max_pages>;
+
+    /**
+     * Run length encode the XOR difference between two snapshots.
+     * @param base snapshot to diff against, nullptr to store target as is
+     * @param target snapshot to encode
+     * @param clean_pages memory pages known to be equal in base and target, nullptr if unknown
+     * @param out encoded data
+     */
+    static void encode(const Snapshot* base, const Snapshot& target, const PageSet* clean_pages,
+                       std::vector<uint8_t>& out);
+
+    /**
+     * Apply encoded XOR difference to snapshot.
+     * @param data encoded data
+     * @param target snapshot to apply difference to
+     */
+    static void decode(std::span<const uint8_t> data, Snapshot& target);
+
+    /**
+     * Restore snapshot for given entry.
+     * @param index index of entry to restore
+     * @param target snapshot to restore to
+     */
+    void restore_entry(size_t index, Snapshot& target) const;
+
+    /**
+     * Drop oldest keyframe groups until history fits in max_bytes, keeping the newest group.
+     */
+    void evict();
+
+    uint32_t interval;
+    uint32_t keyframe_interval;
+    size_t max_bytes;
+    bool enabled;
+
+    std::deque<Entry> entries;
+    size_t total_bytes;
+    uint32_t frame_counter;
+    uint32_t entries_since_keyframe;
+    bool force_keyframe;
+
+    std::unique_ptr<Snapshot> current;      // Scratch snapshot for recording.
+    std::unique_ptr<Snapshot> keyframe;     // Latest keyframe, base for new deltas.
+    std::unique_ptr<Snapshot> restored;     // Last restored state while rewinding.
+    bool has_restored;
+
+    // Overhead statistics.
+    std::chrono::steady_clock::duration record_time;
+    uint64_t recorded_count;
+    uint64_t frame_count;
+};
+
+#endif // REWIND_H
@@ -18,8 +18,9 @@
 #ifndef SNAPSHOT_H
 #define SNAPSHOT_H
 
-#include <memory>
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <type_traits>
 
 #include "chip/mos6522.hpp"
 #include "chip/ay3_8912.hpp"
@@ -59,23 +60,58 @@ public:
 };
 
 
+constexpr size_t snapshot_memory_size = 64*1024;
+
+
 /**
- * Snapshot of states for whole machine.
+ * State for ULA (video).
  */
-class Snapshot
+class ULA_state
+{
+public:
+    uint16_t raster_current;
+    uint8_t video_attrib;
+    uint8_t text_attrib;
+    uint8_t blink;
+    uint32_t frame_count;
+};
+
+
+/**
+ * State for Machine, not belonging to any chip.
+ */
+class Machine_state
 {
 public:
-    Snapshot();
-    ~Snapshot();
+    uint64_t total_cycles;
+    int32_t cycle_count;
+    uint8_t key_rows[8];
+    bool oric_rom_enabled;
+    bool disk_rom_enabled;
+};
+
 
+/**
+ * Snapshot of states for whole machine. Fixed size and trivially copyable,
+ * so that taking and restoring a snapshot never allocates.
+ */
+class Snapshot
+{
+public:
+    Machine_state machine;
     MOS6502_state mos6502;
+    ULA_state ula;
     MOS6522::State mos6522;
     AY3_8912::SoundState ay3_8919;
     WD1793::State wd1793;
     DriveMicrodrive::State drive_microdrive;
 
-    std::vector<uint8_t> memory;
+    uint64_t memory_id;         // Memory the snapshot was saved from, 0 if none.
+    uint32_t memory_epoch;      // Memory write epoch at time of saving.
+    std::array<uint8_t, snapshot_memory_size> memory;
 };
 
+static_assert(std::is_trivially_copyable_v<Snapshot>, "Snapshot must be trivially copyable");
+
 
 #endif // SNAPSHOT_H
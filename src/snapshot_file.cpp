@@ -0,0 +1,228 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include "mapped_file.hpp"
+#include "snapshot_file.hpp"
+
+namespace
+{
+    struct Section
+    {
+        char id[4];
+        std::span<uint8_t> data;
+    };
+
+    template <typename T>
+    std::span<uint8_t> bytes_of(T& value)
+    {
+        return {reinterpret_cast<uint8_t*>(&value), sizeof(T)};
+    }
+
+    /**
+     * Return all sections of a snapshot, in the order they are written.
+     * @param snapshot snapshot to get sections of
+     * @return array of sections
+     */
+    std::array<Section, 8> sections_of(Snapshot& snapshot)
+    {
+        return {{
+            {{'M', 'A', 'C', 'H'}, bytes_of(snapshot.machine)},
+            {{'C', 'P', 'U', ' '}, bytes_of(snapshot.mos6502)},
+            {{'U', 'L', 'A', ' '}, bytes_of(snapshot.ula)},
+            {{'V', 'I', 'A', ' '}, bytes_of(snapshot.mos6522)},
+            {{'A', 'Y', ' ', ' '}, bytes_of(snapshot.ay3_8919)},
+            {{'F', 'D', 'C', ' '}, bytes_of(snapshot.wd1793)},
+            {{'D', 'R', 'V', ' '}, bytes_of(snapshot.drive_microdrive)},
+            {{'R', 'A', 'M', ' '}, std::span<uint8_t>(snapshot.memory)}
+        }};
+    }
+
+    /**
+     * Build lookup tables for CRC32, one per byte position in a 64 bit word.
+     * @return lookup tables
+     */
+    constexpr std::array<std::array<uint32_t, 256>, 8> make_crc32_tables()
+    {
+        std::array<std::array<uint32_t, 256>, 8> tables{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            tables[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (size_t t = 1; t < tables.size(); t++) {
+                tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xff];
+            }
+        }
+        return tables;
+    }
+
+    constexpr auto crc32_tables = make_crc32_tables();
+}
+
+
+uint32_t SnapshotFile::crc32(std::span<const uint8_t> data)
+{
+    const auto& t = crc32_tables;
+    uint32_t crc = 0xffffffff;
+    size_t i = 0;
+
+    // Process eight bytes per step (slicing-by-8), it is several times faster than per byte.
+    for (; i + 8 <= data.size(); i += 8) {
+        const uint8_t* p = data.data() + i;
+        const uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24));
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; i < data.size(); i++) {
+        crc = t[0][(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+void SnapshotFile::write(std::ostream& out, const Snapshot& snapshot, uint32_t rom_crc)
+{
+    // Disk track and sector pointers are not valid in another session, they are resolved
+    // from track and sector numbers when loading.
+    auto copy = std::make_unique<Snapshot>(snapshot);
+    copy->wd1793.current_track = nullptr;
+    copy->wd1793.current_sector = nullptr;
+
+    const auto sections = sections_of(*copy);
+
+    FileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.section_count = sections.size();
+    header.rom_crc = rom_crc;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& section : sections) {
+        SectionHeader section_header{};
+        std::memcpy(section_header.id, section.id, sizeof(section_header.id));
+        section_header.size = section.data.size();
+        section_header.crc = crc32(section.data);
+        out.write(reinterpret_cast<const char*>(&section_header), sizeof(section_header));
+        out.write(reinterpret_cast<const char*>(section.data.data()), section.data.size());
+    }
+}
+
+void SnapshotFile::save(const std::filesystem::path& path, const Snapshot& snapshot, uint32_t rom_crc)
+{
+    // Write to a temporary file first, to not destroy an existing snapshot on failure.
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (! file) {
+            throw std::runtime_error(std::format("could not open file: {}", tmp_path.string()));
+        }
+
+        write(file, snapshot, rom_crc);
+
+        if (! file) {
+            throw std::runtime_error(std::format("could not write file: {}", tmp_path.string()));
+        }
+    }
+
+    std::filesystem::rename(tmp_path, path);
+}
+
+uint32_t SnapshotFile::load(const std::filesystem::path& path, Snapshot& snapshot)
+{
+    MappedFile file;
+    file.open(path);
+    return read({file.data(), file.size()}, snapshot);
+}
+
+uint32_t SnapshotFile::read(std::span<const uint8_t> data, Snapshot& snapshot)
+{
+    if (data.size() < sizeof(FileHeader)) {
+        throw std::runtime_error("file too short for snapshot header");
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("not an Auric snapshot file");
+    }
+    if (header.version != version) {
+        throw std::runtime_error(std::format("unsupported snapshot version {} (expected {})",
+                                             header.version, version));
+    }
+
+    auto sections = sections_of(snapshot);
+    std::array<bool, sections.size()> found{};
+
+    size_t pos = sizeof(FileHeader);
+    for (uint16_t i = 0; i < header.section_count; i++) {
+        if (data.size() - pos < sizeof(SectionHeader)) {
+            throw std::runtime_error("snapshot file is truncated");
+        }
+
+        SectionHeader section_header;
+        std::memcpy(&section_header, data.data() + pos, sizeof(section_header));
+        pos += sizeof(SectionHeader);
+
+        if (data.size() - pos < section_header.size) {
+            throw std::runtime_error("snapshot file is truncated");
+        }
+        auto section_data = data.subspan(pos, section_header.size);
+        pos += section_header.size;
+
+        const std::string id(section_header.id, sizeof(section_header.id));
+        if (crc32(section_data) != section_header.crc) {
+            throw std::runtime_error(std::format("checksum error in snapshot section '{}'", id));
+        }
+
+        for (size_t s = 0; s < sections.size(); s++) {
+            if (std::memcmp(sections[s].id, section_header.id, sizeof(section_header.id)) != 0) {
+                continue;
+            }
+            if (section_data.size() != sections[s].data.size()) {
+                throw std::runtime_error(std::format("snapshot section '{}' has size {}, expected {}",
+                                                     id, section_data.size(), sections[s].data.size()));
+            }
+            std::memcpy(sections[s].data.data(), section_data.data(), section_data.size());
+            found[s] = true;
+        }
+    }
+
+    for (size_t s = 0; s < sections.size(); s++) {
+        if (! found[s]) {
+            throw std::runtime_error(std::format("snapshot section '{}' is missing",
+                                                 std::string(sections[s].id, sizeof(sections[s].id))));
+        }
+    }
+
+    snapshot.wd1793.current_track = nullptr;
+    snapshot.wd1793.current_sector = nullptr;
+    snapshot.memory_id = 0;
+    snapshot.memory_epoch = 0;
+
+    return header.rom_crc;
+}
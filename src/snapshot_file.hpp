@@ -0,0 +1,107 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef SNAPSHOT_FILE_H
+#define SNAPSHOT_FILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+
+#include "snapshot.hpp"
+
+
+/**
+ * Reads and writes snapshots as files, to keep machine state between sessions.
+ *
+ * A file starts with a header, followed by one section per chip and one for RAM. Each
+ * section has an id, a size and a CRC32 of its data. Sections with unknown ids are
+ * skipped, while a known section with unexpected size is rejected, as that means the
+ * state layout has changed. Data is stored in host byte order.
+ *
+ * Loading maps the file into memory and copies each section straight into the
+ * snapshot, without any intermediate buffers.
+ */
+class SnapshotFile
+{
+public:
+    static constexpr char magic[8] = {'A', 'U', 'R', 'I', 'C', 'S', 'N', 'P'};
+    static constexpr uint16_t version = 2;
+    static constexpr const char* extension = ".snap";
+
+    /**
+     * Write snapshot to file.
+     * @param path path of file to write
+     * @param snapshot snapshot to write
+     * @param rom_crc CRC32 of the ROM the snapshot was taken with
+     * @throws std::runtime_error if the file could not be written
+     */
+    static void save(const std::filesystem::path& path, const Snapshot& snapshot, uint32_t rom_crc);
+
+    /**
+     * Read snapshot from file. Memory is marked as not saved from any memory, so that
+     * loading it into a machine copies all of it.
+     * @param path path of file to read
+     * @param snapshot snapshot to read into
+     * @return CRC32 of the ROM the snapshot was taken with
+     * @throws std::runtime_error if the file could not be read or is not valid
+     */
+    static uint32_t load(const std::filesystem::path& path, Snapshot& snapshot);
+
+    /**
+     * Write snapshot in file format to stream, for embedding in other files.
+     * @param out stream to write to
+     * @param snapshot snapshot to write
+     * @param rom_crc CRC32 of the ROM the snapshot was taken with
+     */
+    static void write(std::ostream& out, const Snapshot& snapshot, uint32_t rom_crc);
+
+    /**
+     * Read snapshot in file format from memory.
+     * @param data snapshot file contents
+     * @param snapshot snapshot to read into
+     * @return CRC32 of the ROM the snapshot was taken with
+     * @throws std::runtime_error if data is not a valid snapshot
+     */
+    static uint32_t read(std::span<const uint8_t> data, Snapshot& snapshot);
+
+    /**
+     * Calculate CRC32 (IEEE 802.3) of data.
+     * @param data data to calculate checksum of
+     * @return checksum
+     */
+    static uint32_t crc32(std::span<const uint8_t> data);
+
+protected:
+    struct FileHeader
+    {
+        char magic[8];
+        uint16_t version;
+        uint16_t section_count;
+        uint32_t rom_crc;
+    };
+
+    struct SectionHeader
+    {
+        char id[4];
+        uint32_t size;
+        uint32_t crc;
+    };
+};
+
+#endif // SNAPSHOT_FILE_H
@@ -0,0 +1,177 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <cstring>
+#include <format>
+#include <print>
+#include <stdexcept>
+#include <string>
+
+#include "hash.hpp"
+#include "machine.hpp"
+#include "state_trace.hpp"
+
+
+uint64_t StateHashes::combined() const
+{
+    return fnv1a_64_values(fnv1a_64_offset, cpu, via, ay, disk, ula, memory);
+}
+
+
+StateTrace::StateTrace() :
+    mode(Mode::Idle),
+    frame(0),
+    last_verified(false)
+{
+}
+
+void StateTrace::start_recording(const std::filesystem::path& path)
+{
+    stop();
+
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (! out) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.record_size = sizeof(Record);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    this->path = path;
+    frame = 0;
+    mode = Mode::Recording;
+    std::println("Recording state trace to {}", path.string());
+}
+
+void StateTrace::start_verifying(const std::filesystem::path& path)
+{
+    stop();
+
+    std::ifstream file(path, std::ios::binary);
+    if (! file) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+
+    FileHeader header;
+    if (! file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("not an Auric state trace file");
+    }
+    if (header.version != version || header.record_size != sizeof(Record)) {
+        throw std::runtime_error(std::format("unsupported state trace version {}", header.version));
+    }
+
+    golden.clear();
+    Record record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        golden.push_back(record);
+    }
+    if (golden.empty()) {
+        throw std::runtime_error("state trace file has no frames");
+    }
+
+    this->path = path;
+    frame = 0;
+    last_verified = false;
+    mode = Mode::Verifying;
+    std::println("Verifying state against {} ({} frames)", path.string(), golden.size());
+}
+
+void StateTrace::stop()
+{
+    if (mode == Mode::Recording) {
+        out.close();
+        std::println("Saved state trace of {} frames to {}", frame, path.string());
+    }
+    else if (mode == Mode::Verifying) {
+        std::println("State verification stopped after {} of {} frames", frame, golden.size());
+    }
+    mode = Mode::Idle;
+}
+
+StateTrace::Record StateTrace::make_record(uint64_t cycle, const StateHashes& hashes)
+{
+    Record record{};
+    record.cycle = cycle;
+    record.cpu = static_cast<uint32_t>(hashes.cpu);
+    record.via = static_cast<uint32_t>(hashes.via);
+    record.ay = static_cast<uint32_t>(hashes.ay);
+    record.disk = static_cast<uint32_t>(hashes.disk);
+    record.ula = static_cast<uint32_t>(hashes.ula);
+    record.memory = static_cast<uint32_t>(hashes.memory);
+    return record;
+}
+
+void StateTrace::frame_done(Machine& machine, const StateHashes& hashes)
+{
+    const Record record = make_record(machine.total_cycles, hashes);
+
+    if (mode == Mode::Recording) {
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        frame++;
+        return;
+    }
+
+    const Record& expected = golden[frame];
+    if (std::memcmp(&record, &expected, sizeof(record)) != 0) {
+        std::string parts;
+        const auto check = [&parts](const char* name, uint64_t a, uint64_t b) {
+            if (a != b) {
+                parts += parts.empty() ? name : std::string(", ") + name;
+            }
+        };
+        check("cycle count", record.cycle, expected.cycle);
+        check("CPU", record.cpu, expected.cpu);
+        check("VIA", record.via, expected.via);
+        check("AY", record.ay, expected.ay);
+        check("disk", record.disk, expected.disk);
+        check("ULA", record.ula, expected.ula);
+        check("memory", record.memory, expected.memory);
+
+        std::println("State diverged at frame {} (cycle {}, expected {}): {} differ",
+                     frame, record.cycle, expected.cycle, parts);
+        mode = Mode::Idle;
+        last_verified = false;
+        machine.stop();     // Stop here, to be able to inspect in the monitor.
+        return;
+    }
+
+    frame++;
+    if (frame == golden.size()) {
+        std::println("State verified for all {} frames of {}", frame, path.string());
+        mode = Mode::Idle;
+        last_verified = true;
+    }
+}
+
+void StateTrace::print_status() const
+{
+    switch (mode) {
+        case Mode::Idle:
+            std::println("No state trace active");
+            break;
+        case Mode::Recording:
+            std::println("Recording state trace to {}: {} frames", path.string(), frame);
+            break;
+        case Mode::Verifying:
+            std::println("Verifying state against {}: frame {} of {}", path.string(), frame, golden.size());
+            break;
+    }
+}
@@ -0,0 +1,143 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef STATE_TRACE_H
+#define STATE_TRACE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+class Machine;
+
+
+/**
+ * Hashes of the state of each part of the machine.
+ */
+struct StateHashes
+{
+    uint64_t cpu;
+    uint64_t via;
+    uint64_t ay;
+    uint64_t disk;
+    uint64_t ula;
+    uint64_t memory;
+
+    /**
+     * Combine all hashes into one.
+     * @return combined hash
+     */
+    uint64_t combined() const;
+};
+
+
+/**
+ * Writes a log of per-frame state hashes, or compares with a previously written log, to
+ * prove that changes to the emulator do not change its behaviour.
+ *
+ * Each frame is logged as the emulated cycle count and a 32 bit hash for each part of
+ * the machine, 32 bytes per frame. When verifying, the first frame that differs from
+ * the log is reported along with which parts differ, and the machine is stopped there
+ * so it can be inspected in the monitor.
+ */
+class StateTrace
+{
+public:
+    static constexpr char magic[8] = {'A', 'U', 'R', 'I', 'C', 'T', 'R', 'C'};
+    static constexpr uint16_t version = 1;
+
+    StateTrace();
+
+    /**
+     * Start writing state hashes to file.
+     * @param path path of file to write
+     * @throws std::runtime_error if the file could not be opened
+     */
+    void start_recording(const std::filesystem::path& path);
+
+    /**
+     * Start comparing state hashes with file.
+     * @param path path of file to compare with
+     * @throws std::runtime_error if the file could not be read or is not valid
+     */
+    void start_verifying(const std::filesystem::path& path);
+
+    /**
+     * Stop recording or verifying.
+     */
+    void stop();
+
+    bool is_active() const { return mode != Mode::Idle; }
+
+    /**
+     * Check if the last verification ran to the end of the log without any difference.
+     * @return true if last verification succeeded
+     */
+    bool verified() const { return last_verified; }
+
+    /**
+     * Called at the end of each emulated frame, to record or verify state hashes.
+     * @param machine machine to trace
+     * @param hashes state hashes at end of frame
+     */
+    void frame_done(Machine& machine, const StateHashes& hashes);
+
+    /**
+     * Print trace status to console.
+     */
+    void print_status() const;
+
+protected:
+    enum class Mode { Idle, Recording, Verifying };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t record_size;
+    };
+
+    struct Record
+    {
+        uint64_t cycle;
+        uint32_t cpu;
+        uint32_t via;
+        uint32_t ay;
+        uint32_t disk;
+        uint32_t ula;
+        uint32_t memory;
+    };
+
+    /**
+     * Create log record for current frame.
+     * @param cycle emulated cycle count
+     * @param hashes state hashes
+     * @return log record
+     */
+    static Record make_record(uint64_t cycle, const StateHashes& hashes);
+
+    Mode mode;
+    std::filesystem::path path;
+    std::ofstream out;
+    std::vector<Record> golden;
+    size_t frame;
+    bool last_verified;
+};
+
+#endif // STATE_TRACE_H
@@ -18,6 +18,29 @@
 #ifndef TAPE_H
 #define TAPE_H
 
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MOS6522;
+
+
+/**
+ * One file (block) on a tape, as found in its header.
+ */
+struct TapeBlock
+{
+    uint32_t offset;            // Offset of the first sync byte.
+    uint32_t body_offset;       // Offset of the first body byte.
+    std::string name;
+    uint8_t file_type;          // $00 BASIC, $80 machine code.
+    uint8_t auto_run;           // $80 run as BASIC, $C7 run as machine code, else no auto-run.
+    uint16_t start_address;
+    uint16_t end_address;
+};
+
 
 class Tape
 {
@@ -50,10 +73,53 @@ public:
      */
     virtual void motor_on(bool motor_on) = 0;
 
+    static constexpr uint64_t no_event = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * Run tape up to given cycle. The machine only calls this when the cycle returned by
+     * the previous call has been reached, or after the motor or tape position has changed.
+     * @param cycle emulated cycle count
+     * @return cycle when the tape must run next, or no_event
+     */
+    virtual uint64_t exec(uint64_t cycle) = 0;
+
+    /**
+     * Create a copy of the tape at its current position, for a forked machine.
+     * Tape data is shared read-only between the copies.
+     * @param via VIA of the forked machine
+     * @return new tape
+     */
+    virtual std::unique_ptr<Tape> fork(MOS6522& via) const = 0;
+
+    /**
+     * Skip past the sync bytes of the next block, for fast loading via ROM traps.
+     * @return true if sync bytes were found
+     */
+    virtual bool fast_sync() { return false; }
+
+    /**
+     * Read next byte, for fast loading via ROM traps.
+     * @param byte reference to store read byte in
+     * @return true if a byte was read
+     */
+    virtual bool fast_read_byte(uint8_t& byte) { return false; }
+
+    /**
+     * Get the files on the tape.
+     * @return blocks in tape order, empty if the tape has no index
+     */
+    virtual const std::vector<TapeBlock>& get_blocks() const
+    {
+        static const std::vector<TapeBlock> no_blocks;
+        return no_blocks;
+    }
+
     /**
-     * Execute one cycle.
+     * Position the tape at the start of a block.
+     * @param index index of block in get_blocks()
+     * @return true if the tape was positioned
      */
-    virtual void exec(uint8_t cycles) = 0;
+    virtual bool seek_block(size_t index) { return false; }
 
     /**
      * Check if motor is running.
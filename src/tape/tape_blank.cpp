@@ -44,6 +44,13 @@ void TapeBlank::motor_on(bool motor_on)
     motor_running = motor_on;
 }
 
-void TapeBlank::exec(uint8_t cycles)
-{}
+uint64_t TapeBlank::exec(uint64_t cycle)
+{
+    return no_event;
+}
+
+std::unique_ptr<Tape> TapeBlank::fork(MOS6522& via) const
+{
+    return std::make_unique<TapeBlank>();
+}
 
@@ -50,9 +50,18 @@ public:
     void motor_on(bool motor_on) override;
 
     /**
-     * Execute one cycle.
+     * Run tape up to given cycle.
+     * @param cycle emulated cycle count
+     * @return cycle when the tape must run next, or no_event
      */
-    void exec(uint8_t cycles) override;
+    uint64_t exec(uint64_t cycle) override;
+
+    /**
+     * Create a copy of the tape at its current position, for a forked machine.
+     * @param via VIA of the forked machine
+     * @return new tape
+     */
+    std::unique_ptr<Tape> fork(MOS6522& via) const override;
 
 protected:
 };
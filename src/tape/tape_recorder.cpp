@@ -0,0 +1,153 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <boost/log/trivial.hpp>
+#include <bit>
+#include <format>
+#include <print>
+#include <stdexcept>
+
+#include "tape_recorder.hpp"
+
+
+TapeRecorder::TapeRecorder() :
+    active(false),
+    bytes_written(0),
+    parity_errors(0),
+    last_level(false),
+    last_rise_cycle(0),
+    first_edge(true),
+    decode_state(DecodeState::WaitStart),
+    bit_count(0),
+    shift(0)
+{
+}
+
+TapeRecorder::~TapeRecorder()
+{
+    stop();
+}
+
+void TapeRecorder::start_recording(const std::filesystem::path& path)
+{
+    stop();
+
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (! out) {
+        throw std::runtime_error(std::format("could not open file: {}", path.string()));
+    }
+
+    this->path = path;
+    buffer.clear();
+    buffer.reserve(buffer_size);
+    bytes_written = 0;
+    parity_errors = 0;
+    first_edge = true;
+    decode_state = DecodeState::WaitStart;
+    active = true;
+    std::println("Recording tape output to {}", path.string());
+}
+
+void TapeRecorder::stop()
+{
+    if (! active) {
+        return;
+    }
+
+    flush();
+    out.close();
+    active = false;
+    std::println("Saved {} bytes of tape output to {}", bytes_written, path.string());
+}
+
+void TapeRecorder::write_byte(uint8_t byte)
+{
+    if (! active) {
+        return;
+    }
+
+    buffer.push_back(byte);
+    ++bytes_written;
+    if (buffer.size() >= buffer_size) {
+        flush();
+    }
+}
+
+void TapeRecorder::print_status() const
+{
+    if (! active) {
+        std::println("Not recording tape output");
+        return;
+    }
+    std::println("Recording tape output to {}: {} bytes, {} parity errors", path.string(), bytes_written, parity_errors);
+}
+
+void TapeRecorder::rising_edge(uint64_t cycle)
+{
+    const uint64_t period = cycle - last_rise_cycle;
+    last_rise_cycle = cycle;
+
+    if (! active) {
+        return;
+    }
+
+    // A pause in output ends any byte in progress.
+    if (first_edge || period > max_bit_cycles) {
+        first_edge = false;
+        decode_state = DecodeState::WaitStart;
+        return;
+    }
+
+    const uint8_t bit = period < one_zero_threshold ? 1 : 0;
+
+    switch (decode_state) {
+        case DecodeState::WaitStart:
+            // Stop bits and idle output are ones, a zero starts a byte.
+            if (bit == 0) {
+                decode_state = DecodeState::Data;
+                bit_count = 0;
+                shift = 0;
+            }
+            break;
+
+        case DecodeState::Data:
+            shift |= bit << bit_count;
+            if (++bit_count == 8) {
+                decode_state = DecodeState::Parity;
+            }
+            break;
+
+        case DecodeState::Parity:
+            // Parity bit makes the number of ones, including the parity bit, odd.
+            if (bit != ((std::popcount(shift) & 0x01) ^ 0x01)) {
+                ++parity_errors;
+                BOOST_LOG_TRIVIAL(debug) << "Tape recorder: parity error at byte " << bytes_written;
+            }
+            write_byte(shift);
+            decode_state = DecodeState::WaitStart;
+            break;
+    }
+}
+
+void TapeRecorder::flush()
+{
+    if (buffer.empty()) {
+        return;
+    }
+    out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    buffer.clear();
+}
@@ -0,0 +1,112 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef TAPE_RECORDER_H
+#define TAPE_RECORDER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+
+/**
+ * Records tape output (VIA PB7) to a TAP file. The pulse train is decoded to bytes
+ * using the emulated cycle count, or bytes are given directly by a trapped ROM routine.
+ */
+class TapeRecorder
+{
+public:
+    TapeRecorder();
+    ~TapeRecorder();
+
+    /**
+     * Start recording to TAP file.
+     * @param path path of file to write
+     * @throws std::runtime_error if the file could not be opened
+     */
+    void start_recording(const std::filesystem::path& path);
+
+    /**
+     * Stop recording, writing buffered bytes to file.
+     */
+    void stop();
+
+    bool is_active() const { return active; }
+
+    /**
+     * Called when tape output may have changed, while the tape motor is running.
+     * @param level current tape output level
+     * @param cycle emulated cycle count
+     */
+    void output_changed(bool level, uint64_t cycle)
+    {
+        if (level != last_level) {
+            last_level = level;
+            if (level) {
+                rising_edge(cycle);
+            }
+        }
+    }
+
+    /**
+     * Record a whole byte, bypassing pulse decoding.
+     * @param byte byte to record
+     */
+    void write_byte(uint8_t byte);
+
+    /**
+     * Print recording status to console.
+     */
+    void print_status() const;
+
+protected:
+    enum class DecodeState { WaitStart, Data, Parity };
+
+    /**
+     * Decode one bit from time since previous rising edge of tape output.
+     * @param cycle emulated cycle count
+     */
+    void rising_edge(uint64_t cycle);
+
+    /**
+     * Write buffered bytes to file.
+     */
+    void flush();
+
+    // A bit is a short high period followed by a short (1) or long (0) low period, so the
+    // time between rising edges is about 416 cycles for a 1 and 624 cycles for a 0.
+    static constexpr uint32_t one_zero_threshold = 520;
+    static constexpr uint32_t max_bit_cycles = 1200;
+    static constexpr size_t buffer_size = 16384;
+
+    bool active;
+    std::filesystem::path path;
+    std::ofstream out;
+    std::vector<uint8_t> buffer;
+    size_t bytes_written;
+    size_t parity_errors;
+
+    bool last_level;
+    uint64_t last_rise_cycle;
+    bool first_edge;
+    DecodeState decode_state;
+    uint8_t bit_count;
+    uint8_t shift;
+};
+
+#endif // TAPE_RECORDER_H
@@ -18,6 +18,7 @@
 #include <boost/log/trivial.hpp>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include <cstdlib>
 #include <format>
 #include <print>
@@ -42,12 +43,42 @@ TapeTap::TapeTap(MOS6522& via, const std::filesystem::path& path) :
     current_byte(0),
     current_bit(0),
     parity(0),
-    tape_cycle_counter(0),
+    next_edge(0),
     line_out(0),
     data(nullptr)
 {
 }
 
+TapeTap::TapeTap(const TapeTap& other, MOS6522& via) :
+    path(other.path),
+    via(via),
+    tape_size(other.tape_size),
+    tape_state(other.tape_state),
+    sync_end(other.sync_end),
+    body_start(other.body_start),
+    body_remaining(other.body_remaining),
+    stopped_mid_byte(other.stopped_mid_byte),
+    leader_count(other.leader_count),
+    gap_bits_remaining(other.gap_bits_remaining),
+    tape_pos(other.tape_pos),
+    bit_index(other.bit_index),
+    current_byte(other.current_byte),
+    current_bit(other.current_bit),
+    parity(other.parity),
+    next_edge(other.next_edge),
+    line_out(other.line_out),
+    memory_vector(other.memory_vector),
+    data(other.data),
+    blocks(other.blocks)
+{
+    motor_running = other.motor_running;
+}
+
+std::unique_ptr<Tape> TapeTap::fork(MOS6522& via) const
+{
+    return std::unique_ptr<Tape>(new TapeTap(*this, via));
+}
+
 void TapeTap::reset()
 {
     motor_running = false;
@@ -62,7 +93,7 @@ void TapeTap::reset()
     current_byte = 0;
     current_bit = 0;
     parity = 0;
-    tape_cycle_counter = 0;
+    next_edge = 0;
     line_out = 0;
 }
 
@@ -76,12 +107,15 @@ bool TapeTap::init()
     if (file.is_open())
     {
         tape_size = file.tellg();
-        memory_vector = std::vector<uint8_t>(tape_size);
-        data = memory_vector.data();
+        auto tape_data = std::make_shared<std::vector<uint8_t>>(tape_size);
 
         file.seekg(0, std::ios::beg);
-        file.read(reinterpret_cast<char*>(data), tape_size);
+        file.read(reinterpret_cast<char*>(tape_data->data()), tape_size);
         file.close();
+
+        memory_vector = std::move(tape_data);
+        data = memory_vector->data();
+        index_blocks();
     }
     else {
         BOOST_LOG_TRIVIAL(warning) << "Tape: unable to open TAP file";
@@ -95,6 +129,16 @@ bool TapeTap::init()
 void TapeTap::print_stat()
 {
     std::println("Current Tape pos: {}", tape_pos);
+
+    const auto& tape_blocks = get_blocks();
+    for (size_t i = 0; i < tape_blocks.size(); i++) {
+        const auto& block = tape_blocks[i];
+        const bool current = block.offset <= tape_pos &&
+                             (i + 1 == tape_blocks.size() || tape_pos < tape_blocks[i + 1].offset);
+        std::println("{} {:2}: {:<16} {} ${:04X}-${:04X}{}", current ? '*' : ' ', i, block.name,
+                     block.file_type == 0x00 ? "BASIC" : "CODE ", block.start_address, block.end_address,
+                     (block.auto_run == 0x80 || block.auto_run == 0xc7) ? " auto" : "");
+    }
 }
 
 
@@ -112,6 +156,12 @@ void TapeTap::motor_on(bool motor_on)
             ++tape_pos;
             stopped_mid_byte = false;
         }
+
+        // After fast loading, bit level output only resumes at the start of a block. Loaders
+        // that restart the motor between header and body are still fed by the ROM traps.
+        if (tape_state == TapeState::FastLoad && (tape_pos >= tape_size || data[tape_pos] != 0x16)) {
+            return;
+        }
         tape_state = TapeState::ParseHeader;
     }
     else {
@@ -125,14 +175,14 @@ void TapeTap::motor_on(bool motor_on)
 }
 
 
-void TapeTap::exec(uint8_t cycles)
+uint64_t TapeTap::exec(uint64_t cycle)
 {
     if (!motor_running) {
-        return;
+        return no_event;
     }
 
-    if (tape_state == TapeState::Idle || tape_state == TapeState::Fail) {
-        return;
+    if (tape_state == TapeState::Idle || tape_state == TapeState::FastLoad || tape_state == TapeState::Fail) {
+        return no_event;
     }
 
     if (tape_state == TapeState::ParseHeader) {
@@ -140,48 +190,53 @@ void TapeTap::exec(uint8_t cycles)
             BOOST_LOG_TRIVIAL(error) << "Tape: failed to read header, stopping.";
             motor_running = false;
             tape_state = TapeState::Fail;
-            return;
+            return no_event;
         }
         via.write_cb1(true);
         line_out = 1;
         tape_state = TapeState::Leader;
-        return;
+
+        // First edge right away.
+        next_edge = cycle;
+        return next_edge;
     }
 
     // End-of-block: hold idle high
     if (tape_state == TapeState::EndOfBlock) {
         via.write_cb1(true);
         line_out = 1;
-        tape_cycle_counter = Pulse_1;
-        return;
+        return no_event;
     }
 
-    // Count down the cycle counter. This ensures that the line_out toggles according to expected bit output.
-    if (tape_cycle_counter > cycles) {
-        tape_cycle_counter -= cycles;
-        return;
+    // An edge is never more than one pulse ahead, unless the machine state was loaded from
+    // an earlier cycle. Timing then restarts from now instead of waiting for the old edge.
+    if (next_edge > cycle + Pulse_0) {
+        next_edge = cycle;
+    }
+
+    if (cycle < next_edge) {
+        return next_edge;
     }
 
-    // At the end of the above cycle count, toggle the output line.
+    // Edges are timed from when they were due, not when they ran, so bit lengths don't drift.
+    // After a long pause (motor or tape position changed), timing restarts from now.
+    if (cycle - next_edge > Pulse_0) {
+        next_edge = cycle;
+    }
+
+    // Toggle the output line according to expected bit output.
     line_out ^= 0x01;
     via.write_cb1(line_out);
 
     // In state Gap we emit a series of bits to allow the reader routine to catch up.
     if (tape_state == TapeState::Gap) {
-        if (line_out) {
-            tape_cycle_counter = Pulse_1;
-            return;
-        } else {
-            tape_cycle_counter = Pulse_1;
-            if (gap_bits_remaining < cycles) {
-                gap_bits_remaining = 0;
+        if (! line_out) {
+            if (--gap_bits_remaining == 0) {
                 tape_state = TapeState::Body;
             }
-            else {
-                gap_bits_remaining -= cycles;
-            }
-            return;
         }
+        next_edge += Pulse_1;
+        return next_edge;
     }
 
     if (line_out) {
@@ -206,9 +261,9 @@ void TapeTap::exec(uint8_t cycles)
             }
         }
 
-        // Get next bit to be output and update cycle counter accordingly.
+        // Get next bit to be output and update next edge accordingly.
         current_bit = next_bit();
-        tape_cycle_counter = Pulse_1;
+        next_edge += Pulse_1;
 
         // Update tape position and possibly switch state.
         if (bit_index == 0) {
@@ -251,54 +306,199 @@ void TapeTap::exec(uint8_t cycles)
     }
     else {
         // Second part of bit, differently long down period.
-        tape_cycle_counter = current_bit ? Pulse_1 : Pulse_0;
+        next_edge += current_bit ? Pulse_1 : Pulse_0;
     }
+
+    return next_edge;
 }
 
 
-bool TapeTap::parse_header()
+bool TapeTap::fast_sync()
+{
+    uint32_t sync_count = 0;
+
+    for (uint32_t pos = tape_pos; pos < tape_size; pos++) {
+        if (data[pos] == 0x16) {
+            ++sync_count;
+        }
+        else if (data[pos] == 0x24 && sync_count >= 3) {
+            tape_pos = pos + 1;
+            enter_fast_load();
+            return true;
+        }
+        else {
+            sync_count = 0;
+        }
+    }
+
+    return false;
+}
+
+
+bool TapeTap::fast_read_byte(uint8_t& byte)
+{
+    if (tape_pos >= tape_size) {
+        return false;
+    }
+
+    byte = data[tape_pos++];
+    enter_fast_load();
+    return true;
+}
+
+
+void TapeTap::enter_fast_load()
+{
+    tape_state = TapeState::FastLoad;
+    stopped_mid_byte = false;
+    bit_index = 0;
+}
+
+
+const std::vector<TapeBlock>& TapeTap::get_blocks() const
+{
+    return blocks ? *blocks : Tape::get_blocks();
+}
+
+
+bool TapeTap::seek_block(size_t index)
+{
+    if (! blocks || index >= blocks->size()) {
+        return false;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Tape: positioned at block " << index << ", " << (*blocks)[index].name;
+    tape_pos = (*blocks)[index].offset;
+    stopped_mid_byte = false;
+    bit_index = 0;
+    tape_state = motor_running ? TapeState::ParseHeader : TapeState::Idle;
+    return true;
+}
+
+
+void TapeTap::index_blocks()
+{
+    auto found = std::make_shared<std::vector<TapeBlock>>();
+    size_t pos = 0;
+
+    while (pos < tape_size) {
+        if (data[pos] != 0x16) {
+            ++pos;
+            continue;
+        }
+
+        TapeBlock block;
+        uint32_t sync_count;
+        std::string error;
+        if (! parse_block(pos, block, sync_count, error)) {
+            pos += std::max<uint32_t>(sync_count, 1);
+            continue;
+        }
+
+        found->push_back(block);
+        pos = std::max(size_t(block.body_offset) + size_t(block.end_address) - size_t(block.start_address) + 1,
+                       size_t(block.body_offset) + 1);
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Tape: found " << found->size() << " files";
+    blocks = std::move(found);
+}
+
+
+bool TapeTap::parse_block(uint32_t offset, TapeBlock& block, uint32_t& sync_count, std::string& error) const
 {
     size_t i{0};
+    sync_count = 0;
 
     while (true)
     {
-        if (tape_pos + i >= tape_size) {
+        if (offset + i >= tape_size) {
+            error = "no data after sync bytes";
             return false;
         }
 
-        if (data[tape_pos + i] != 0x16) {
+        if (data[offset + i] != 0x16) {
             break;
         }
 
         ++i;
     }
-
-    BOOST_LOG_TRIVIAL(debug) << "Tape: found " << i << " sync bytes (0x16)";
-    uint16_t sync_len = i;
-    sync_end = tape_pos + i;
+    sync_count = i;
 
     if (i < 3) {
-        BOOST_LOG_TRIVIAL(warning) << "Tape: too few sync bytes, failing.";
+        error = "too few sync bytes";
         return false;
     }
 
-    if (data[tape_pos + i] != 0x24) {
-        BOOST_LOG_TRIVIAL(warning) << "Tape: missing end of sync bytes (0x24), failing.";
+    if (data[offset + i] != 0x24) {
+        error = "missing end of sync bytes (0x24)";
         return false;
     }
 
     ++i;
 
-    if (i + 9 >= tape_size) {
-        BOOST_LOG_TRIVIAL(warning) << "Tape: too short (no specs and addresses).";
+    if (offset + i + 9 >= tape_size) {
+        error = "too short (no specs and addresses)";
         return false;
     }
 
     // Skip reserved bytes.
     i += 2;
 
-    auto file_type = data[tape_pos + i];
-    switch(file_type)
+    block.offset = offset;
+    block.file_type = data[offset + i++];
+    block.auto_run = data[offset + i++];
+
+    block.end_address = data[offset + i] << 8 | data[offset + i + 1];
+    i += 2;
+
+    block.start_address = data[offset + i] << 8 | data[offset + i + 1];
+    i += 2;
+
+    if (block.end_address < block.start_address) {
+        error = "end address before start address";
+        return false;
+    }
+
+    // Skip one reserved byte.
+    i++;
+
+    block.name.clear();
+    while (true)
+    {
+        if (offset + i >= tape_size) {
+            error = "no end of file name";
+            return false;
+        }
+
+        if (data[offset + i] == 0x00) {
+            break;
+        }
+
+        block.name += data[offset + i];
+        ++i;
+    }
+
+    block.body_offset = offset + i + 1;
+    return true;
+}
+
+
+bool TapeTap::parse_header()
+{
+    TapeBlock block;
+    uint32_t sync_len;
+    std::string error;
+
+    if (! parse_block(tape_pos, block, sync_len, error)) {
+        BOOST_LOG_TRIVIAL(warning) << "Tape: " << error << ", failing.";
+        return false;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Tape: found " << sync_len << " sync bytes (0x16)";
+    sync_end = tape_pos + sync_len;
+
+    switch(block.file_type)
     {
         case 0x00:
             BOOST_LOG_TRIVIAL(debug) << "Tape: file is BASIC.";
@@ -310,10 +510,8 @@ bool TapeTap::parse_header()
             BOOST_LOG_TRIVIAL(debug) << "Tape: file is unknown.";
             break;
     }
-    i++;
 
-    uint8_t auto_flag = data[tape_pos + i];
-    switch(auto_flag)
+    switch(block.auto_run)
     {
         case 0x80:
             BOOST_LOG_TRIVIAL(debug) << "Tape: run automatically as BASIC.";
@@ -325,45 +523,17 @@ bool TapeTap::parse_header()
             BOOST_LOG_TRIVIAL(debug) << "Tape: Don't run automatically.";
             break;
     }
-    i++;
 
-    const bool basic_mode = (file_type == 0x00) || (auto_flag == 0x80);
+    const bool basic_mode = (block.file_type == 0x00) || (block.auto_run == 0x80);
     size_t desired_sync = basic_mode ? 192 : 112;
 
-    uint16_t start_address;
-    uint16_t end_address;
-
-    end_address = data[tape_pos + i] << 8 | data[tape_pos + i + 1];
-    i += 2;
-
-    start_address = data[tape_pos + i] << 8 | data[tape_pos + i + 1];
-    i += 2;
-
-    BOOST_LOG_TRIVIAL(debug) << std::format("Tape: start address: ${:04x}", start_address);
-    BOOST_LOG_TRIVIAL(debug) << std::format("Tape:   end address: ${:04x}", end_address);
-
-    // Skip one reserved byte.
-    i++;
-
-    std::string name;
-    while (true)
-    {
-        if (tape_pos + i >= tape_size) {
-            return false;
-        }
-
-        if (data[tape_pos + i] == 0x00) {
-            break;
-        }
-
-        name += data[tape_pos + i];
-        ++i;
-    }
-    BOOST_LOG_TRIVIAL(info) << "Tape: file name: " << name;
+    BOOST_LOG_TRIVIAL(debug) << std::format("Tape: start address: ${:04x}", block.start_address);
+    BOOST_LOG_TRIVIAL(debug) << std::format("Tape:   end address: ${:04x}", block.end_address);
+    BOOST_LOG_TRIVIAL(info) << "Tape: file name: " << block.name;
 
     // Store where body starts, to allow delay after header.
-    body_start = tape_pos + i + 1;
-    body_remaining = uint32_t(end_address) - size_t(start_address) + 1;
+    body_start = block.body_offset;
+    body_remaining = uint32_t(block.end_address) - size_t(block.start_address) + 1;
 
     leader_count = (sync_len < desired_sync) ? (desired_sync - sync_len) : 0;
 
@@ -20,6 +20,8 @@
 
 #include <memory>
 #include <filesystem>
+#include <string>
+#include <vector>
 
 #include "chip/mos6522.hpp"
 #include "tape.hpp"
@@ -35,6 +37,7 @@ class TapeTap : public Tape
         Gap,
         Body,
         EndOfBlock,
+        FastLoad,
         Fail
     };
 
@@ -66,23 +69,85 @@ public:
     void motor_on(bool motor_on) override;
 
     /**
-     * Execute one cycle.
+     * Run tape up to given cycle, changing CB1 if an edge is due.
+     * @param cycle emulated cycle count
+     * @return cycle of next edge, or no_event
      */
-    void exec(uint8_t cycles) override;
+    uint64_t exec(uint64_t cycle) override;
+
+    /**
+     * Create a copy of the tape at its current position, for a forked machine.
+     * @param via VIA of the forked machine
+     * @return new tape
+     */
+    std::unique_ptr<Tape> fork(MOS6522& via) const override;
+
+    /**
+     * Skip past the sync bytes of the next block, for fast loading via ROM traps.
+     * @return true if sync bytes were found
+     */
+    bool fast_sync() override;
+
+    /**
+     * Read next byte, for fast loading via ROM traps.
+     * @param byte reference to store read byte in
+     * @return true if a byte was read
+     */
+    bool fast_read_byte(uint8_t& byte) override;
+
+    /**
+     * Get the files on the tape, indexed when the tape was inserted.
+     * @return blocks in tape order
+     */
+    const std::vector<TapeBlock>& get_blocks() const override;
+
+    /**
+     * Position the tape at the start of a block.
+     * @param index index of block in get_blocks()
+     * @return true if the tape was positioned
+     */
+    bool seek_block(size_t index) override;
 
 protected:
     /**
-     * Read tape header.
+     * Copy tape state and share tape data with other, for a forked machine.
+     * @param other tape to copy
+     * @param via VIA of the forked machine
+     */
+    TapeTap(const TapeTap& other, MOS6522& via);
+
+    /**
+     * Read tape header at current tape position.
      * @return true if header is valid
      */
     bool parse_header();
 
+    /**
+     * Parse block header.
+     * @param offset offset of first sync byte
+     * @param block block to fill in
+     * @param sync_count set to number of sync bytes found
+     * @param error set to reason if header is not valid
+     * @return true if header is valid
+     */
+    bool parse_block(uint32_t offset, TapeBlock& block, uint32_t& sync_count, std::string& error) const;
+
+    /**
+     * Find all blocks on the tape, in one pass.
+     */
+    void index_blocks();
+
     /**
      * Get current bit value.
      * @return current bit value
      */
     uint8_t next_bit();
 
+    /**
+     * Stop bit level output, as the ROM routines are fed directly.
+     */
+    void enter_fast_load();
+
     std::filesystem::path path;
     MOS6522& via;
     size_t tape_size;
@@ -103,11 +168,12 @@ protected:
     uint8_t current_bit;
     uint8_t parity;
 
-    int16_t tape_cycle_counter;
+    uint64_t next_edge;     // Cycle of next CB1 edge.
     uint8_t line_out;
 
-    std::vector<uint8_t> memory_vector;
-    uint8_t* data;
+    std::shared_ptr<const std::vector<uint8_t>> memory_vector;     // Shared with forks.
+    const uint8_t* data;
+    std::shared_ptr<const std::vector<TapeBlock>> blocks;          // Shared with forks.
 
     static const int Pulse_1 = 208;
     static const int Pulse_0 = 416;
@@ -0,0 +1,259 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <boost/log/trivial.hpp>
+#include <algorithm>
+#include <cstring>
+#include <print>
+#include <stdexcept>
+
+#include "tape_wav.hpp"
+
+
+namespace
+{
+    uint16_t read_le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    uint32_t read_le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+}
+
+
+TapeWav::TapeWav(MOS6522& via, const std::filesystem::path& path) :
+    path(path),
+    via(via),
+    data_offset(0),
+    sample_count(0),
+    sample_rate(0),
+    block_align(0),
+    bits_per_sample(0),
+    decode_pos(0),
+    decode_level(false),
+    edge_index(0),
+    next_edge_cycle(no_event),
+    tape_cycle(0),
+    last_cycle(0),
+    resync(true),
+    line_level(false)
+{
+}
+
+TapeWav::TapeWav(const TapeWav& other, MOS6522& via) :
+    path(other.path),
+    via(via),
+    file(other.file),
+    data_offset(other.data_offset),
+    sample_count(other.sample_count),
+    sample_rate(other.sample_rate),
+    block_align(other.block_align),
+    bits_per_sample(other.bits_per_sample),
+    decode_pos(other.decode_pos),
+    decode_level(other.decode_level),
+    edges(other.edges),
+    edge_index(other.edge_index),
+    next_edge_cycle(other.next_edge_cycle),
+    tape_cycle(other.tape_cycle),
+    last_cycle(other.last_cycle),
+    resync(other.resync),
+    line_level(other.line_level)
+{
+    motor_running = other.motor_running;
+}
+
+std::unique_ptr<Tape> TapeWav::fork(MOS6522& via) const
+{
+    return std::unique_ptr<Tape>(new TapeWav(*this, via));
+}
+
+bool TapeWav::init()
+{
+    BOOST_LOG_TRIVIAL(info) << "Tape: Reading WAV file '" << path << "'";
+
+    auto mapped = std::make_shared<MappedFile>();
+    try {
+        mapped->open(path);
+    }
+    catch (const std::runtime_error& err) {
+        BOOST_LOG_TRIVIAL(warning) << "Tape: " << err.what();
+        return false;
+    }
+    mapped->advise_sequential();
+    file = std::move(mapped);
+
+    if (! parse_header()) {
+        file.reset();
+        return false;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Tape: " << sample_rate << " Hz, " << bits_per_sample << " bits, "
+                            << sample_count / sample_rate << " seconds";
+    reset();
+    return true;
+}
+
+bool TapeWav::parse_header()
+{
+    const uint8_t* data = file->data();
+    const size_t size = file->size();
+
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        BOOST_LOG_TRIVIAL(warning) << "Tape: not a WAV file";
+        return false;
+    }
+
+    bool found_format = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = data + pos;
+        const size_t chunk_size = read_le32(chunk + 4);
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && pos + 8 + 16 <= size) {
+            const uint16_t format = read_le16(chunk + 8);
+            sample_rate = read_le32(chunk + 12);
+            block_align = read_le16(chunk + 20);
+            bits_per_sample = read_le16(chunk + 22);
+
+            // PCM, or WAVE_FORMAT_EXTENSIBLE which is PCM in practice.
+            if ((format != 1 && format != 0xfffe) || (bits_per_sample != 8 && bits_per_sample != 16) ||
+                sample_rate == 0 || block_align < bits_per_sample / 8) {
+                BOOST_LOG_TRIVIAL(warning) << "Tape: unsupported WAV format, use 8 or 16 bit PCM";
+                return false;
+            }
+            found_format = true;
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (! found_format) {
+                break;
+            }
+
+            // Recordings that were never finished may have a wrong data size, use what's there.
+            data_offset = pos + 8;
+            const size_t data_size = std::min(chunk_size, size - data_offset);
+            sample_count = data_size / block_align;
+            return true;
+        }
+
+        pos += 8 + chunk_size + (chunk_size & 0x01);
+    }
+
+    BOOST_LOG_TRIVIAL(warning) << "Tape: no sample data in WAV file";
+    return false;
+}
+
+void TapeWav::reset()
+{
+    motor_running = false;
+    decode_pos = 0;
+    decode_level = false;
+    edges.clear();
+    edge_index = 0;
+    next_edge_cycle = no_event;
+    tape_cycle = 0;
+    resync = true;
+    line_level = false;
+
+    if (file) {
+        load_next_edge();
+    }
+}
+
+void TapeWav::print_stat()
+{
+    std::println("Current Tape pos: {:.1f} s of {:.1f} s", double(tape_cycle) / cpu_frequency,
+                 sample_rate ? double(sample_count) / sample_rate : 0.0);
+}
+
+void TapeWav::motor_on(bool motor_on)
+{
+    if (motor_on == motor_running) {
+        return;
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Tape: motor " << (motor_on ? "on" : "off");
+    motor_running = motor_on;
+    resync = true;
+}
+
+uint64_t TapeWav::exec(uint64_t cycle)
+{
+    if (! motor_running) {
+        return no_event;
+    }
+
+    // The tape only moves while the motor runs. Loading machine state can also move the cycle
+    // back, the tape then continues from where it is.
+    if (resync || cycle < last_cycle) {
+        last_cycle = cycle;
+        resync = false;
+    }
+    tape_cycle += cycle - last_cycle;
+    last_cycle = cycle;
+
+    while (tape_cycle >= next_edge_cycle) {
+        line_level = ! line_level;
+        via.write_cb1(line_level);
+        advance_edge();
+    }
+
+    return next_edge_cycle == no_event ? no_event : cycle + (next_edge_cycle - tape_cycle);
+}
+
+int32_t TapeWav::sample(uint64_t index) const
+{
+    const uint8_t* p = file->data() + data_offset + index * block_align;
+    if (bits_per_sample == 8) {
+        return (int32_t(p[0]) - 128) << 8;
+    }
+    return int16_t(read_le16(p));
+}
+
+void TapeWav::advance_edge()
+{
+    ++edge_index;
+    load_next_edge();
+}
+
+void TapeWav::load_next_edge()
+{
+    while (edge_index >= edges.size()) {
+        if (decode_pos >= sample_count) {
+            next_edge_cycle = no_event;
+            return;
+        }
+        decode_batch();
+    }
+    next_edge_cycle = edges[edge_index];
+}
+
+void TapeWav::decode_batch()
+{
+    edges.clear();
+    edge_index = 0;
+
+    const uint64_t batch_start = decode_pos;
+    const uint64_t batch_end = std::min(decode_pos + batch_samples, sample_count);
+
+    // Hysteresis: the level only changes when the signal has clearly crossed zero.
+    for (uint64_t i = batch_start; i < batch_end; i++) {
+        const int32_t value = sample(i);
+        if (decode_level ? value < -hysteresis : value > hysteresis) {
+            decode_level = ! decode_level;
+            edges.push_back(i * cpu_frequency / sample_rate);
+        }
+    }
+    decode_pos = batch_end;
+
+    // Decoded samples are not needed again unless the tape is reset.
+    file->release(data_offset + batch_start * block_align, (batch_end - batch_start) * block_align);
+}
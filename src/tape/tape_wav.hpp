@@ -0,0 +1,139 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#ifndef TAPE_WAV_H
+#define TAPE_WAV_H
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "chip/mos6522.hpp"
+#include "mapped_file.hpp"
+#include "tape.hpp"
+
+
+/**
+ * Tape from a WAV recording. The file is memory mapped and decoded to signal edges
+ * batch by batch while playing, so memory use doesn't grow with the length of the recording.
+ */
+class TapeWav : public Tape
+{
+public:
+    TapeWav(MOS6522& via, const std::filesystem::path& path);
+
+    virtual ~TapeWav() = default;
+
+    /**
+     * Initialize tape.
+     * @return true on success
+     */
+    bool init() override;
+
+    /**
+     * Reset tape postion.
+     */
+    void reset() override;
+
+    /**
+     * Print tape status to console.
+     */
+    void print_stat() override;
+
+    /**
+     * Set motor state.
+     * @param motor_on true if motor is on
+     */
+    void motor_on(bool motor_on) override;
+
+    /**
+     * Run tape up to given cycle, changing CB1 for edges that are due.
+     * @param cycle emulated cycle count
+     * @return cycle of next edge, or no_event
+     */
+    uint64_t exec(uint64_t cycle) override;
+
+    /**
+     * Create a copy of the tape at its current position, for a forked machine.
+     * @param via VIA of the forked machine
+     * @return new tape
+     */
+    std::unique_ptr<Tape> fork(MOS6522& via) const override;
+
+protected:
+    /**
+     * Copy tape state and share the mapped file with other, for a forked machine.
+     * @param other tape to copy
+     * @param via VIA of the forked machine
+     */
+    TapeWav(const TapeWav& other, MOS6522& via);
+
+    /**
+     * Read format and find sample data in WAV header.
+     * @return true if the file is a supported WAV file
+     */
+    bool parse_header();
+
+    /**
+     * Get first channel of a sample, scaled to 16 bits.
+     * @param index sample index
+     * @return sample value
+     */
+    int32_t sample(uint64_t index) const;
+
+    /**
+     * Move to next edge, decoding more samples when the current batch is used up.
+     */
+    void advance_edge();
+
+    /**
+     * Load cycle of the edge at edge_index, decoding batches until one is found.
+     */
+    void load_next_edge();
+
+    /**
+     * Decode next batch of samples to edges.
+     */
+    void decode_batch();
+
+    static constexpr uint32_t cpu_frequency = 1000000;
+    static constexpr uint64_t batch_samples = 65536;
+    static constexpr int32_t hysteresis = 1024;     // Of 16 bit full scale, ignores noise around zero.
+
+    std::filesystem::path path;
+    MOS6522& via;
+    std::shared_ptr<MappedFile> file;   // Shared with forks.
+
+    size_t data_offset;
+    uint64_t sample_count;
+    uint32_t sample_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+
+    uint64_t decode_pos;                // Next sample to decode.
+    bool decode_level;
+    std::vector<uint64_t> edges;        // Cycles of edges in current batch, alternating level.
+    size_t edge_index;
+    uint64_t next_edge_cycle;
+
+    uint64_t tape_cycle;                // Cycles played while the motor has been running.
+    uint64_t last_cycle;                // Emulated cycle of last exec.
+    bool resync;                        // Motor was started, restart counting from next exec.
+    bool line_level;
+};
+
+#endif // TAPE_WAV_H
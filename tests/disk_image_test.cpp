@@ -0,0 +1,465 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/config.hpp"
+#include "../src/disk/disk_image.hpp"
+#include "../src/machine.hpp"
+#include "../src/oric.hpp"
+
+namespace Unittest {
+
+using namespace testing;
+
+constexpr uint32_t test_track_size = 6400;
+constexpr uint32_t test_header_size = 256;
+constexpr uint8_t test_sectors = 17;
+constexpr uint32_t test_first_sector = 40;         // Offset of first sector ID in track.
+constexpr uint32_t test_sector_stride = 10 + 22 + 4 + 256 + 2 + 24;
+
+
+class DiskImageTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        path = std::filesystem::temp_directory_path() / "auric_disk_image_test.dsk";
+        write_image(path, 1, 2);
+    }
+
+    virtual void TearDown()
+    {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path.string() + ".journal");
+    }
+
+    /**
+     * Write an MFM disk image with sectors of 256 bytes. Each sector is filled with the
+     * given value, or with its track number.
+     */
+    static void write_image(const std::filesystem::path& path, uint8_t sides, uint8_t tracks,
+                            uint8_t sectors = test_sectors, std::optional<uint8_t> fill = {})
+    {
+        std::vector<uint8_t> image(test_header_size + sides * tracks * test_track_size, 0x4e);
+        std::fill_n(image.begin(), test_header_size, 0);
+        std::copy_n("MFM_DISK", 8, image.begin());
+        image[8] = sides;
+        image[12] = tracks;
+        image[16] = 1;
+
+        for (uint8_t side = 0; side < sides; side++) {
+            for (uint8_t track = 0; track < tracks; track++) {
+                auto pos = image.begin() + test_header_size + (side * tracks + track) * test_track_size + test_first_sector;
+                for (uint8_t sector = 1; sector <= sectors; sector++) {
+                    const uint8_t id[] = {0xa1, 0xa1, 0xa1, 0xfe, track, side, sector, 1, 0, 0};
+                    pos = std::copy(std::begin(id), std::end(id), pos) + 22;
+                    pos = std::copy_n("\xa1\xa1\xa1\xfb", 4, pos);
+                    pos = std::fill_n(pos, 256, fill.value_or(track)) + 2 + 24;
+                }
+            }
+        }
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(image.data()), image.size());
+    }
+
+    /**
+     * Get offset in the image file of the data of a sector, for images from write_image.
+     */
+    static size_t sector_data_offset(size_t track_index, uint8_t sector)
+    {
+        return test_header_size + track_index * test_track_size + test_first_sector +
+               (sector - 1) * test_sector_stride + 10 + 22 + 4;
+    }
+
+    /**
+     * Store program at $0500 and start the CPU there.
+     */
+    static void load_program(Machine& machine, std::span<const uint8_t> program)
+    {
+        for (uint16_t i = 0; i < program.size(); i++) {
+            Machine::write_byte(machine, 0x0500 + i, program[i]);
+        }
+        machine.cpu->set_pc(0x0500);
+    }
+
+    std::filesystem::path path;
+};
+
+
+TEST_F(DiskImageTest, FindsSectors)
+{
+    DiskImage image(path);
+    ASSERT_TRUE(image.init());
+    ASSERT_EQ(1, image.side_count());
+    ASSERT_EQ(2, image.tracks_count());
+
+    auto* track = image.get_track(0, 1);
+    ASSERT_NE(nullptr, track);
+    EXPECT_EQ(test_sectors, track->sector_count());
+
+    auto* sector = track->get_sector(5);
+    ASSERT_NE(nullptr, sector);
+    EXPECT_EQ(256, sector->data.size());
+    EXPECT_EQ(1, sector->data[0]);
+    EXPECT_EQ(nullptr, track->get_sector(test_sectors + 1));
+    EXPECT_EQ(nullptr, track->get_sector(0));
+    EXPECT_EQ(nullptr, track->get_sector(0x1ff));
+
+    for (uint8_t number = 1; number <= test_sectors; number++) {
+        ASSERT_NE(nullptr, track->get_sector(number));
+        EXPECT_EQ(number, track->get_sector(number)->sector_number);
+    }
+}
+
+TEST_F(DiskImageTest, ParsesTrackOnFirstAccess)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    DiskTrack track(std::span<uint8_t>(image.data() + test_header_size, test_track_size));
+    EXPECT_FALSE(track.is_parsed());
+    EXPECT_EQ(nullptr, track.get_sector(1));
+
+    track.parse();
+    EXPECT_TRUE(track.is_parsed());
+    EXPECT_EQ(test_sectors, track.sector_count());
+    EXPECT_NE(nullptr, track.get_sector(1));
+}
+
+TEST_F(DiskImageTest, RejectsTruncatedImage)
+{
+    std::filesystem::resize_file(path, test_header_size + test_track_size);
+    DiskImage image(path);
+    EXPECT_FALSE(image.init());
+}
+
+TEST_F(DiskImageTest, ForkCopiesTrackOnWrite)
+{
+    DiskImage image(path);
+    ASSERT_TRUE(image.init());
+
+    {
+        auto fork = image.fork();
+
+        // Tracks are shared until written.
+        EXPECT_EQ(image.get_track(0, 0)->data.data(), fork->get_track(0, 0)->data.data());
+
+        EXPECT_TRUE(fork->prepare_write(0, 0));
+        EXPECT_FALSE(fork->prepare_write(0, 0));
+        fork->get_track(0, 0)->get_sector(1)->data[0] = 0xaa;
+
+        EXPECT_NE(image.get_track(0, 0)->data.data(), fork->get_track(0, 0)->data.data());
+        EXPECT_EQ(0, image.get_track(0, 0)->get_sector(1)->data[0]);
+        EXPECT_EQ(image.get_track(0, 1)->data.data(), fork->get_track(0, 1)->data.data());
+
+        // A fork of the fork has its own copy of the written track.
+        auto fork_of_fork = fork->fork();
+        EXPECT_EQ(0xaa, fork_of_fork->get_track(0, 0)->get_sector(1)->data[0]);
+        EXPECT_NE(fork->get_track(0, 0)->data.data(), fork_of_fork->get_track(0, 0)->data.data());
+
+        // The original must not write into data shared with forks either.
+        EXPECT_TRUE(image.prepare_write(0, 1));
+    }
+
+    // Without forks, the original writes in place.
+    EXPECT_FALSE(image.prepare_write(0, 0));
+}
+
+TEST_F(DiskImageTest, WritesChangedTrackToFile)
+{
+    {
+        DiskImage image(path);
+        ASSERT_TRUE(image.init());
+
+        EXPECT_FALSE(image.prepare_write(0, 1));
+        image.get_track(0, 1)->get_sector(3)->data[0] = 0xaa;
+        image.mark_dirty(0, 1);
+        image.flush();
+    }
+
+    DiskImage image(path);
+    ASSERT_TRUE(image.init());
+    EXPECT_EQ(0xaa, image.get_track(0, 1)->get_sector(3)->data[0]);
+    EXPECT_EQ(1, image.get_track(0, 1)->get_sector(4)->data[0]);
+}
+
+TEST_F(DiskImageTest, JournaledWriteGoesThroughCopy)
+{
+    {
+        DiskImage image(path, true);
+        ASSERT_TRUE(image.init());
+
+        // Journaled writes must not touch the image until the journal is written.
+        EXPECT_TRUE(image.prepare_write(0, 0));
+        image.get_track(0, 0)->get_sector(1)->data[0] = 0x55;
+        image.mark_dirty(0, 0);
+
+        DiskImage unchanged(path);
+        ASSERT_TRUE(unchanged.init());
+        EXPECT_EQ(0, unchanged.get_track(0, 0)->get_sector(1)->data[0]);
+
+        image.flush();
+    }
+
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".journal"));
+    DiskImage image(path);
+    ASSERT_TRUE(image.init());
+    EXPECT_EQ(0x55, image.get_track(0, 0)->get_sector(1)->data[0]);
+}
+
+TEST_F(DiskImageTest, ReplaysCompleteJournal)
+{
+    const auto journal = path.string() + ".journal";
+    const auto write_journal = [&journal](size_t length) {
+        std::vector<uint8_t> entries{'A', 'U', 'R', 'I', 'C', 'T', 'R', 'K', 1, 0, 0, 0};
+        entries.insert(entries.end(), {test_header_size & 0xff, test_header_size >> 8, 0, 0,
+                                       test_track_size & 0xff, test_track_size >> 8, 0, 0});
+        entries.resize(entries.size() + test_track_size, 0x77);
+        entries.resize(length);
+        std::ofstream(journal, std::ios::binary).write(reinterpret_cast<const char*>(entries.data()), entries.size());
+    };
+
+    // An incomplete journal is dropped, as the image was never written.
+    write_journal(1000);
+    {
+        DiskImage image(path);
+        ASSERT_TRUE(image.init());
+        EXPECT_EQ(0x4e, image.get_track(0, 0)->data[0]);
+    }
+    EXPECT_FALSE(std::filesystem::exists(journal));
+
+    write_journal(20 + test_track_size);
+    {
+        DiskImage image(path);
+        ASSERT_TRUE(image.init());
+        EXPECT_EQ(0x77, image.get_track(0, 0)->data[0]);
+        EXPECT_EQ(0x4e, image.get_track(0, 1)->data[0]);
+    }
+    EXPECT_FALSE(std::filesystem::exists(journal));
+}
+
+TEST_F(DiskImageTest, OverlayKeepsImageUnchanged)
+{
+    const auto overlay = path.string() + ".overlay";
+    {
+        DiskImage image(path, false, DiskOverlay::File);
+        ASSERT_TRUE(image.init());
+
+        EXPECT_TRUE(image.prepare_write(0, 1));
+        image.get_track(0, 1)->get_sector(2)->data[0] = 0xcc;
+        image.mark_dirty(0, 1);
+        image.flush();
+        EXPECT_EQ(1, image.overlay_track_count());
+    }
+    EXPECT_TRUE(std::filesystem::exists(overlay));
+
+    {
+        DiskImage master(path);
+        ASSERT_TRUE(master.init());
+        EXPECT_EQ(1, master.get_track(0, 1)->get_sector(2)->data[0]);
+    }
+
+    // The overlay is loaded with the image, and can be merged into it.
+    {
+        DiskImage image(path, false, DiskOverlay::File);
+        ASSERT_TRUE(image.init());
+        EXPECT_EQ(0xcc, image.get_track(0, 1)->get_sector(2)->data[0]);
+        EXPECT_TRUE(image.merge_overlay());
+    }
+    EXPECT_FALSE(std::filesystem::exists(overlay));
+
+    DiskImage master(path);
+    ASSERT_TRUE(master.init());
+    EXPECT_EQ(0xcc, master.get_track(0, 1)->get_sector(2)->data[0]);
+}
+
+TEST_F(DiskImageTest, LoadsRawSectorDump)
+{
+    // 40 tracks of 17 sectors, each sector filled with its track and sector number.
+    constexpr uint8_t dump_tracks = 40;
+    std::vector<uint8_t> dump(dump_tracks * test_sectors * 256);
+    for (size_t i = 0; i < dump.size(); i++) {
+        const size_t sector = i / 256;
+        dump[i] = static_cast<uint8_t>((sector / test_sectors) << 4 | (sector % test_sectors));
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(dump.data()), dump.size());
+    }
+
+    {
+        DiskImage image(path);
+        ASSERT_TRUE(image.init());
+        ASSERT_EQ(1, image.side_count());
+        ASSERT_EQ(dump_tracks, image.tracks_count());
+
+        auto* track = image.get_track(0, 3);
+        ASSERT_NE(nullptr, track);
+        EXPECT_EQ(test_sectors, track->sector_count());
+        ASSERT_NE(nullptr, track->get_sector(5));
+        EXPECT_EQ(0x34, track->get_sector(5)->data[0]);
+        EXPECT_EQ(nullptr, track->get_sector(test_sectors + 1));
+
+        track->get_sector(5)->data[0] = 0xcc;
+        image.mark_dirty(0, 3);
+        image.flush();
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    in.seekg((3 * test_sectors + 4) * 256);
+    EXPECT_EQ(0xcc, in.get());
+}
+
+TEST_F(DiskImageTest, SynthesisesTrackFromSectors)
+{
+    std::vector<uint8_t> sectors(test_sectors * 256);
+    for (size_t i = 0; i < sectors.size(); i++) {
+        sectors[i] = static_cast<uint8_t>(i / 256 + 1);
+    }
+
+    auto track = DiskTrack::from_sectors(sectors, 7, 1);
+    EXPECT_TRUE(track.data.empty());
+
+    track.build_track_data();
+    ASSERT_GE(track.data.size(), test_track_size);
+
+    // The synthesised track must parse back to the same sectors.
+    std::vector<uint8_t> raw(track.data.begin(), track.data.end());
+    DiskTrack parsed(raw);
+    parsed.parse();
+    ASSERT_EQ(test_sectors, parsed.sector_count());
+    for (uint8_t number = 1; number <= test_sectors; number++) {
+        ASSERT_NE(nullptr, parsed.get_sector(number));
+        EXPECT_TRUE(std::equal(parsed.get_sector(number)->data.begin(), parsed.get_sector(number)->data.end(),
+                               track.get_sector(number)->data.begin()));
+    }
+
+    // ID field of the first sector, with track, side and its CRC.
+    const uint8_t id_mark[] = {0xa1, 0xa1, 0xa1, 0xfe};
+    auto id = std::search(raw.begin(), raw.end(), std::begin(id_mark), std::end(id_mark));
+    ASSERT_NE(raw.end(), id);
+    EXPECT_EQ(7, id[4]);
+    EXPECT_EQ(1, id[5]);
+    EXPECT_EQ(1, id[6]);
+}
+
+TEST_F(DiskImageTest, FastDiskTransferSkipsDataRequestWait)
+{
+    write_image(path, 1, 1, 1, 0x5a);
+
+    // SEI, restore, read sector 1 and store it at $0400 with the standard DRQ polling loop.
+    const uint8_t program[] = {0x78, 0xa9, 0x00, 0x8d, 0x10, 0x03, 0xa9, 0x01, 0x8d, 0x12, 0x03,
+                               0xa9, 0x80, 0x8d, 0x10, 0x03, 0xa2, 0x00,
+                               0xad, 0x18, 0x03, 0x30, 0xfb,                // LDA $0318, BMI back
+                               0xad, 0x13, 0x03, 0x9d, 0x00, 0x04, 0xe8, 0xd0, 0xf2,
+                               0x4c, 0x20, 0x05};
+    const auto cycles_to_read = [&](bool fast) {
+        Config config;
+        config.set_disk_path(path);
+        config.set_disk_fast_transfer(fast);
+        Machine machine(config);
+        machine.init();
+        machine.reset_cpu();
+
+        load_program(machine, program);
+        machine.cpu->set_breakpoint(0x0520);
+        EXPECT_FALSE(machine.run_frames(2));
+
+        EXPECT_EQ(0x0520, machine.cpu->get_pc());
+        EXPECT_EQ(0x5a, machine.memory.mem[0x0400]);
+        EXPECT_EQ(0x5a, machine.memory.mem[0x04ff]);
+        return machine.total_cycles;
+    };
+
+    const uint64_t slow = cycles_to_read(false);
+    const uint64_t fast = cycles_to_read(true);
+    EXPECT_LT(fast * 3 / 2, slow);
+}
+
+TEST_F(DiskImageTest, MultiSectorWriteReachesFile)
+{
+    // With a journal, writes go to a copy of the track and only reach the file if the
+    // track is marked dirty.
+    write_image(path, 1, 1, 2, 0x00);
+
+    // SEI, restore, write multiple sectors from sector 1, filling them with 0xc3.
+    const uint8_t program[] = {0x78, 0xa9, 0x00, 0x8d, 0x10, 0x03, 0xa9, 0x01, 0x8d, 0x12, 0x03,
+                               0xa9, 0xb0, 0x8d, 0x10, 0x03, 0xa2, 0x00,
+                               0xad, 0x18, 0x03, 0x30, 0xfb,                // LDA $0318, BMI back
+                               0xa9, 0xc3, 0x8d, 0x13, 0x03, 0xe8, 0xd0, 0xf3,
+                               0xad, 0x18, 0x03, 0x30, 0xfb,
+                               0xa9, 0xc3, 0x8d, 0x13, 0x03, 0xe8, 0xd0, 0xf3,
+                               0x4c, 0x2c, 0x05};
+    {
+        Config config;
+        config.set_disk_path(path);
+        config.set_disk_journal(true);
+        Machine machine(config);
+        machine.init();
+        machine.reset_cpu();
+
+        load_program(machine, program);
+        machine.cpu->set_breakpoint(0x052c);
+        EXPECT_FALSE(machine.run_frames(4));
+        EXPECT_EQ(0x052c, machine.cpu->get_pc());
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    for (uint8_t sector = 1; sector <= 2; sector++) {
+        const auto data = image.begin() + sector_data_offset(0, sector);
+        EXPECT_EQ(256, std::count(data, data + 256, 0xc3));
+    }
+}
+
+TEST_F(DiskImageTest, BootCacheKeyFollowsRomAndDisk)
+{
+    Config config;
+    config.set_disk_path(path);
+    Oric oric(config);
+    oric.init_machine();
+    oric.get_machine().init();
+
+    // Same ROMs and disk find the same cached state.
+    const auto cached = oric.boot_cache_path();
+    EXPECT_EQ(cached, oric.boot_cache_path());
+
+    // Changed ROM or disk contents miss it.
+    auto& rom = oric.get_machine().oric_rom->get_memory_vector();
+    rom[0] ^= 0xff;
+    EXPECT_NE(cached, oric.boot_cache_path());
+    rom[0] ^= 0xff;
+    EXPECT_EQ(cached, oric.boot_cache_path());
+
+    write_image(path, 1, 2, test_sectors, 0xe5);
+    EXPECT_NE(cached, oric.boot_cache_path());
+
+    // Fast transfers boot differently, and have their own state.
+    write_image(path, 1, 2);
+    config.set_disk_fast_transfer(true);
+    EXPECT_NE(cached, oric.boot_cache_path());
+}
+
+} // Unittest
@@ -0,0 +1,489 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <gtest/gtest.h>
+
+#include "../src/batch_runner.hpp"
+#include "../src/config.hpp"
+#include "../src/machine.hpp"
+#include "../src/movie.hpp"
+#include "../src/oric.hpp"
+#include "../src/rewind.hpp"
+#include "../src/snapshot.hpp"
+#include "../src/snapshot_file.hpp"
+#include "../src/state_trace.hpp"
+
+
+namespace Unittest {
+
+using namespace testing;
+
+
+class SnapshotTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        Config config;
+
+        oric = new Oric(config);
+        oric->init_machine();
+
+        Machine& machine = oric->get_machine();
+        machine.init_cpu();
+        machine.init_mos6522();
+        machine.init_ay3();
+        machine.init_disk();
+        machine.reset_cpu();
+    }
+
+    virtual void TearDown()
+    {
+        delete oric;
+    }
+
+    Oric* oric;
+};
+
+
+TEST_F(SnapshotTest, IsTriviallyCopyable)
+{
+    EXPECT_TRUE(std::is_trivially_copyable_v<Snapshot>);
+    EXPECT_TRUE(std::is_trivially_copyable_v<AY3_8912::SoundState>);
+}
+
+TEST_F(SnapshotTest, RestoresMachineState)
+{
+    Machine& machine = oric->get_machine();
+
+    Machine::write_byte(machine, 0x0000, 0x12);
+    Machine::write_byte(machine, 0xbfff, 0x34);
+    machine.cpu->set_pc(0x1234);
+    machine.mos_6522->write_byte(MOS6522::DDRA, 0xa5);
+
+    auto snapshot = std::make_unique<Snapshot>();
+    machine.save_snapshot(*snapshot);
+
+    Machine::write_byte(machine, 0x0000, 0x56);
+    Machine::write_byte(machine, 0xbfff, 0x78);
+    machine.cpu->set_pc(0x4321);
+    machine.mos_6522->write_byte(MOS6522::DDRA, 0x5a);
+
+    machine.load_snapshot(*snapshot);
+
+    EXPECT_EQ(0x12, machine.memory.mem[0x0000]);
+    EXPECT_EQ(0x34, machine.memory.mem[0xbfff]);
+    EXPECT_EQ(0x1234, machine.cpu->get_pc());
+    EXPECT_EQ(0xa5, machine.mos_6522->read_byte(MOS6522::DDRA));
+}
+
+
+TEST_F(SnapshotTest, RewindStepsBackThroughHistory)
+{
+    Machine& machine = oric->get_machine();
+    Rewind rewind(1, 3, 1024 * 1024);
+
+    for (uint8_t i = 0; i < 10; i++) {
+        Machine::write_byte(machine, 0x0500, i);
+        Machine::write_byte(machine, 0x9000 + i, 0xff);
+        rewind.record_frame(machine);
+    }
+
+    for (int i = 9; i >= 0; i--) {
+        EXPECT_EQ(i > 0, rewind.rewind_frame(machine));
+        EXPECT_EQ(i, machine.memory.mem[0x0500]);
+        EXPECT_EQ(0xff, machine.memory.mem[0x9000 + i]);
+        if (i < 9) {
+            EXPECT_NE(0xff, machine.memory.mem[0x9000 + i + 1]);
+        }
+    }
+}
+
+TEST_F(SnapshotTest, RewindEvictsOldestHistory)
+{
+    Machine& machine = oric->get_machine();
+    Rewind rewind(1, 2, 4096);
+
+    for (uint32_t i = 0; i < 20; i++) {
+        // Changing every RAM page makes each entry large, forcing eviction.
+        for (uint32_t page = 0; page < 0xc0; page++) {
+            if (page != 0x03) {     // Skip I/O page.
+                Machine::write_byte(machine, page * 256, i);
+            }
+        }
+        rewind.record_frame(machine);
+    }
+
+    // Latest state must still be restorable.
+    rewind.rewind_frame(machine);
+    EXPECT_EQ(19, machine.memory.mem[0x0000]);
+}
+
+TEST_F(SnapshotTest, RewindKeepsNewestGroupWithTinyBuffer)
+{
+    Machine& machine = oric->get_machine();
+    Rewind rewind(1, 4, 0);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        Machine::write_byte(machine, 0x0000, i);
+        rewind.record_frame(machine);
+    }
+
+    // Keyframe groups of four entries, the newest group is kept whatever the buffer size.
+    EXPECT_TRUE(rewind.rewind_frame(machine));
+    EXPECT_EQ(9, machine.memory.mem[0x0000]);
+    EXPECT_TRUE(rewind.rewind_frame(machine));
+    EXPECT_EQ(8, machine.memory.mem[0x0000]);
+}
+
+TEST_F(SnapshotTest, OnlyWrittenPagesAreCopied)
+{
+    Machine& machine = oric->get_machine();
+    auto snapshot = std::make_unique<Snapshot>();
+
+    machine.save_snapshot(*snapshot);
+
+    // Bypassing write tracking, so not copied on next save.
+    machine.memory.mem[0x2000] = 0xaa;
+    Machine::write_byte(machine, 0x4000, 0xbb);
+    machine.save_snapshot(*snapshot);
+
+    EXPECT_NE(0xaa, snapshot->memory[0x2000]);
+    EXPECT_EQ(0xbb, snapshot->memory[0x4000]);
+
+    // A tracked write makes the whole page be copied.
+    Machine::write_byte(machine, 0x20ff, 0x01);
+    machine.save_snapshot(*snapshot);
+    EXPECT_EQ(0xaa, snapshot->memory[0x2000]);
+
+    // Loading restores written pages.
+    Machine::write_byte(machine, 0x4000, 0xcc);
+    machine.load_snapshot(*snapshot);
+    EXPECT_EQ(0xbb, machine.memory.mem[0x4000]);
+}
+
+TEST_F(SnapshotTest, SavesAndLoadsStateFile)
+{
+    Machine& machine = oric->get_machine();
+    auto path = std::filesystem::temp_directory_path() / "auric_snapshot_test.snap";
+
+    Machine::write_byte(machine, 0x2000, 0x12);
+    machine.cpu->set_pc(0x1234);
+    machine.save_state_file(path);
+
+    Machine::write_byte(machine, 0x2000, 0x56);
+    machine.cpu->set_pc(0x4321);
+    machine.load_state_file(path);
+
+    EXPECT_EQ(0x12, machine.memory.mem[0x2000]);
+    EXPECT_EQ(0x1234, machine.cpu->get_pc());
+
+    // Flip a byte in RAM section, which must fail the checksum.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-16, std::ios::end);
+        char c = 0;
+        file.read(&c, 1);
+        file.seekp(-16, std::ios::end);
+        c ^= 0xff;
+        file.write(&c, 1);
+    }
+    EXPECT_THROW(machine.load_state_file(path), std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+TEST_F(SnapshotTest, MovieReplayIsVerified)
+{
+    Machine& machine = oric->get_machine();
+    machine.init_tape();
+    machine.video_enabled = false;
+
+    // INC $0200, JMP $0500
+    const uint8_t program[] = {0xee, 0x00, 0x02, 0x4c, 0x00, 0x05};
+    for (uint16_t i = 0; i < sizeof(program); i++) {
+        Machine::write_byte(machine, 0x0500 + i, program[i]);
+    }
+    machine.cpu->set_pc(0x0500);
+
+    auto path = std::filesystem::temp_directory_path() / "auric_movie_test.movie";
+    Movie& movie = machine.get_movie();
+
+    movie.start_recording(path, machine);
+    ASSERT_TRUE(machine.run_frame());
+    machine.key_press(0x12, true);
+    ASSERT_TRUE(machine.run_frame());
+    machine.key_press(0x12, false);
+    ASSERT_TRUE(machine.run_frame());
+    movie.stop(machine);
+    const uint64_t end_hash = machine.state_hash();
+
+    // Replay follows the recording exactly.
+    movie.start_playback(path, machine);
+    while (movie.is_playing()) {
+        ASSERT_TRUE(machine.run_frame());
+    }
+    EXPECT_TRUE(movie.verified());
+    EXPECT_EQ(end_hash, machine.state_hash());
+
+    // Replay with state changed behind its back is detected.
+    movie.start_playback(path, machine);
+    ASSERT_TRUE(machine.run_frame());
+    Machine::write_byte(machine, 0x1000, 0x42);
+    while (movie.is_playing()) {
+        ASSERT_TRUE(machine.run_frame());
+    }
+    EXPECT_FALSE(movie.verified());
+
+    std::filesystem::remove(path);
+}
+
+TEST_F(SnapshotTest, MovieRecordedWithVideoReplaysHeadless)
+{
+    Machine& machine = oric->get_machine();
+    machine.init_tape();
+
+    // INC $0200, JMP $0500, with a HIRES attribute at the start of the text screen.
+    const uint8_t program[] = {0xee, 0x00, 0x02, 0x4c, 0x00, 0x05};
+    for (uint16_t i = 0; i < sizeof(program); i++) {
+        Machine::write_byte(machine, 0x0500 + i, program[i]);
+    }
+    Machine::write_byte(machine, 0xbb80, 0x1e);
+    machine.cpu->set_pc(0x0500);
+
+    auto path = std::filesystem::temp_directory_path() / "auric_movie_headless_test.movie";
+    Movie& movie = machine.get_movie();
+
+    // Recorded as shown on screen, without warp.
+    machine.video_enabled = true;
+    machine.warpmode_on = false;
+    movie.start_recording(path, machine);
+    for (int frame = 0; frame < 30; frame++) {
+        ASSERT_TRUE(machine.run_frame());
+    }
+    movie.stop(machine);
+
+    // Replayed as with --headless, in warp mode with video disabled.
+    movie.start_playback(path, machine);
+    machine.run_movie_headless();
+    EXPECT_TRUE(movie.verified());
+
+    std::filesystem::remove(path);
+}
+
+TEST_F(SnapshotTest, MemoryHashFollowsWrites)
+{
+    Machine& machine = oric->get_machine();
+    Memory fresh(machine.memory.get_size());
+
+    const uint8_t old_value = machine.memory.mem[0x1234];
+    const uint64_t initial = machine.memory.hash();
+    Machine::write_byte(machine, 0x1234, old_value ^ 0xff);
+    const uint64_t written = machine.memory.hash();
+    EXPECT_NE(initial, written);
+
+    // Same contents hashed from scratch gives same hash as incremental update.
+    std::copy_n(machine.memory.mem, machine.memory.get_size(), fresh.mem);
+    fresh.mark_all_written();
+    EXPECT_EQ(written, fresh.hash());
+
+    // Writing the old value back gives the initial hash again.
+    Machine::write_byte(machine, 0x1234, old_value);
+    EXPECT_EQ(initial, machine.memory.hash());
+}
+
+TEST_F(SnapshotTest, StateTraceFindsFirstDivergentFrame)
+{
+    Machine& machine = oric->get_machine();
+    machine.init_tape();
+    machine.warpmode_on = true;     // run_frame spans several frames, so the stop lands inside it.
+    machine.video_enabled = false;
+
+    // INC $0200, JMP $0500
+    const uint8_t program[] = {0xee, 0x00, 0x02, 0x4c, 0x00, 0x05};
+    for (uint16_t i = 0; i < sizeof(program); i++) {
+        Machine::write_byte(machine, 0x0500 + i, program[i]);
+    }
+    machine.cpu->set_pc(0x0500);
+
+    auto path = std::filesystem::temp_directory_path() / "auric_trace_test.trace";
+    auto start = std::make_unique<Snapshot>();
+    machine.save_snapshot(*start);
+
+    StateTrace& trace = machine.get_state_trace();
+    trace.start_recording(path);
+    ASSERT_TRUE(machine.run_frame());
+    ASSERT_TRUE(machine.run_frame());
+    trace.stop();
+
+    // Running again from the same state matches the trace.
+    machine.load_snapshot(*start);
+    trace.start_verifying(path);
+    ASSERT_TRUE(machine.run_frame());
+    ASSERT_TRUE(machine.run_frame());
+    EXPECT_TRUE(trace.verified());
+    EXPECT_FALSE(trace.is_active());
+
+    // A change is caught at the first frame after it, and stops the machine there.
+    machine.load_snapshot(*start);
+    trace.start_verifying(path);
+    ASSERT_TRUE(machine.run_frame());
+    machine.cpu->X ^= 0xff;
+    EXPECT_FALSE(machine.run_frame());
+    EXPECT_FALSE(trace.verified());
+    EXPECT_FALSE(trace.is_active());
+
+    std::filesystem::remove(path);
+}
+
+TEST(MachineTest, RunsInParallelThreads)
+{
+    const Config config;
+    constexpr size_t machine_count = 4;
+    std::vector<uint64_t> hashes(machine_count);
+
+    auto run_machine = [&config](uint8_t seed) {
+        Machine machine(config);
+        machine.init();
+        machine.reset_cpu();
+
+        // Count up from seed at $0200: INC $0200, JMP $0500
+        const uint8_t program[] = {0xee, 0x00, 0x02, 0x4c, 0x00, 0x05};
+        for (uint16_t i = 0; i < sizeof(program); i++) {
+            Machine::write_byte(machine, 0x0500 + i, program[i]);
+        }
+        Machine::write_byte(machine, 0x0200, seed);
+        machine.cpu->set_pc(0x0500);
+
+        for (int frame = 0; frame < 10; frame++) {
+            machine.run_frame();
+        }
+        return machine.state_hash();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < machine_count; i++) {
+        threads.emplace_back([&, i] { hashes[i] = run_machine(i % 2); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Machines share nothing, so equal inputs give equal results in any thread.
+    EXPECT_EQ(run_machine(0), hashes[0]);
+    EXPECT_EQ(hashes[0], hashes[2]);
+    EXPECT_EQ(hashes[1], hashes[3]);
+    EXPECT_NE(hashes[0], hashes[1]);
+}
+
+TEST(MachineTest, BatchRunnerReportsErrorsInOrder)
+{
+    Config config;
+    BatchRunner runner(config, std::filesystem::temp_directory_path(), 1);
+
+    const std::vector<std::filesystem::path> images{"missing_1.tap", "missing_2.dsk", "missing_3.tap"};
+    auto results = runner.run(images, 2);
+
+    ASSERT_EQ(images.size(), results.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        EXPECT_EQ(images[i], results[i].image);
+        EXPECT_FALSE(results[i].ok);
+        EXPECT_FALSE(results[i].error.empty());
+    }
+}
+
+TEST(MachineTest, ForkRunsLikeOriginal)
+{
+    const Config config;
+    Machine machine(config);
+    machine.init();
+    machine.reset_cpu();
+
+    // INC $0200, JMP $0500
+    const uint8_t program[] = {0xee, 0x00, 0x02, 0x4c, 0x00, 0x05};
+    for (uint16_t i = 0; i < sizeof(program); i++) {
+        Machine::write_byte(machine, 0x0500 + i, program[i]);
+    }
+    machine.cpu->set_pc(0x0500);
+    ASSERT_TRUE(machine.run_frames(3));
+
+    auto fork = machine.fork();
+    EXPECT_EQ(machine.state_hash(), fork->state_hash());
+    EXPECT_EQ(machine.oric_rom, fork->oric_rom);
+
+    ASSERT_TRUE(machine.run_frames(5));
+    ASSERT_TRUE(fork->run_frames(5));
+    EXPECT_EQ(machine.state_hash(), fork->state_hash());
+
+    // Changes to a fork stay in the fork.
+    const uint8_t value = machine.memory.mem[0x0200];
+    Machine::write_byte(*fork, 0x0200, value + 0x80);
+    EXPECT_EQ(value, machine.memory.mem[0x0200]);
+
+    // Forking again only copies what changed, and still matches.
+    ASSERT_TRUE(machine.run_frames(1));
+    auto second_fork = machine.fork();
+    EXPECT_EQ(machine.state_hash(), second_fork->state_hash());
+}
+
+TEST(MachineTest, FastLoadReadsTapeThroughRomTraps)
+{
+    const auto path = std::filesystem::temp_directory_path() / "auric_fast_load_test.tap";
+    {
+        const uint8_t tap[] = {0x16, 0x16, 0x16, 0x24, 0xab, 0xcd};
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(tap), sizeof(tap));
+    }
+
+    Config config;
+    config.set_tape_path(path);
+    config.set_tape_fast_load(true);
+    Machine machine(config);
+    machine.init();
+    machine.reset_cpu();
+
+    // ROM tape routines that never return: JMP to themselves.
+    const uint16_t rom_routines[] = {0xe735, 0xe6c9};
+    for (uint16_t address : rom_routines) {
+        machine.oric_rom->mem[address - 0xc000] = 0x4c;
+        machine.oric_rom->mem[address - 0xc000 + 1] = address & 0xff;
+        machine.oric_rom->mem[address - 0xc000 + 2] = address >> 8;
+    }
+
+    // JSR sync, JSR read byte, STA $0400, JSR read byte, STA $0401, JMP to self
+    const uint8_t program[] = {0x20, 0x35, 0xe7, 0x20, 0xc9, 0xe6, 0x8d, 0x00, 0x04,
+                               0x20, 0xc9, 0xe6, 0x8d, 0x01, 0x04, 0x4c, 0x0f, 0x05};
+    for (uint16_t i = 0; i < sizeof(program); i++) {
+        Machine::write_byte(machine, 0x0500 + i, program[i]);
+    }
+    machine.cpu->set_pc(0x0500);
+    ASSERT_TRUE(machine.run_frames(1));
+
+    EXPECT_EQ(0x050f, machine.cpu->get_pc());
+    EXPECT_EQ(0xab, machine.memory.mem[0x0400]);
+    EXPECT_EQ(0xcd, machine.memory.mem[0x0401]);
+    EXPECT_EQ(0xcd, machine.memory.mem[0x002f]);
+
+    std::filesystem::remove(path);
+}
+
+} // Unittest
@@ -0,0 +1,247 @@
+// =========================================================================
+//   Copyright (C) 2009-2026 by Anders Piniesjö <pugo@pugo.org>
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program.  If not, see <http://www.gnu.org/licenses/>
+// =========================================================================
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/config.hpp"
+#include "../src/machine.hpp"
+#include "../src/tape/tape_recorder.hpp"
+#include "../src/tape/tape_tap.hpp"
+#include "../src/tape/tape_wav.hpp"
+
+namespace Unittest {
+
+using namespace testing;
+
+
+class TapeTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        path = std::filesystem::temp_directory_path() / "auric_tape_test.tap";
+        machine = std::make_unique<Machine>(config);
+        machine->init();
+    }
+
+    virtual void TearDown()
+    {
+        std::filesystem::remove(path);
+    }
+
+    /**
+     * Append a machine code block with the given name and body to a TAP image.
+     */
+    static void add_block(std::vector<uint8_t>& image, const std::string& name, uint16_t start,
+                          const std::vector<uint8_t>& body)
+    {
+        const uint16_t end = start + body.size() - 1;
+        image.insert(image.end(), {0x16, 0x16, 0x16, 0x16, 0x24, 0x00, 0x00, 0x80, 0x00,
+                                   uint8_t(end >> 8), uint8_t(end), uint8_t(start >> 8), uint8_t(start), 0x00});
+        image.insert(image.end(), name.begin(), name.end());
+        image.push_back(0x00);
+        image.insert(image.end(), body.begin(), body.end());
+    }
+
+    void write_image(const std::vector<uint8_t>& image)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(image.data()), image.size());
+    }
+
+    Config config;
+    std::unique_ptr<Machine> machine;
+    std::filesystem::path path;
+};
+
+
+TEST_F(TapeTest, IndexesBlocks)
+{
+    std::vector<uint8_t> image;
+    add_block(image, "FIRST", 0x0500, {0x01, 0x02, 0x03});
+    image.insert(image.end(), {0x00, 0x16, 0x00});        // Junk between blocks is skipped.
+    const uint32_t second_offset = image.size();
+    add_block(image, "SECOND", 0x9800, {0x16, 0x16, 0x16, 0x16, 0x24});
+    write_image(image);
+
+    TapeTap tape(*machine->mos_6522, path);
+    ASSERT_TRUE(tape.init());
+
+    const auto& blocks = tape.get_blocks();
+    ASSERT_EQ(2, blocks.size());
+    EXPECT_EQ("FIRST", blocks[0].name);
+    EXPECT_EQ(0, blocks[0].offset);
+    EXPECT_EQ(0x0500, blocks[0].start_address);
+    EXPECT_EQ(0x0502, blocks[0].end_address);
+    EXPECT_EQ(0x80, blocks[0].file_type);
+    EXPECT_EQ("SECOND", blocks[1].name);
+    EXPECT_EQ(second_offset, blocks[1].offset);
+    EXPECT_EQ(0x9804, blocks[1].end_address);
+}
+
+TEST_F(TapeTest, SkipsBlockEndingBeforeStart)
+{
+    std::vector<uint8_t> image;
+    add_block(image, "BROKEN", 0x0500, {0x01, 0x02, 0x03});
+    image[9] = 0x04;                                        // End address 0x0402, before start.
+    add_block(image, "VALID", 0x0600, {0x04});
+    write_image(image);
+
+    TapeTap tape(*machine->mos_6522, path);
+    ASSERT_TRUE(tape.init());
+
+    const auto& blocks = tape.get_blocks();
+    ASSERT_EQ(1, blocks.size());
+    EXPECT_EQ("VALID", blocks[0].name);
+}
+
+TEST_F(TapeTest, SeeksToBlock)
+{
+    std::vector<uint8_t> image;
+    add_block(image, "A", 0x0500, {0xaa});
+    add_block(image, "B", 0x0600, {0xbb});
+    write_image(image);
+
+    TapeTap tape(*machine->mos_6522, path);
+    ASSERT_TRUE(tape.init());
+    EXPECT_FALSE(tape.seek_block(2));
+    ASSERT_TRUE(tape.seek_block(1));
+
+    // Reading from the tape now finds the header of the second block.
+    ASSERT_TRUE(tape.fast_sync());
+    std::vector<uint8_t> header(9);
+    for (auto& byte : header) {
+        ASSERT_TRUE(tape.fast_read_byte(byte));
+    }
+    EXPECT_EQ(0x06, header[6]);
+}
+
+TEST_F(TapeTest, TimesEdgesFromDeadlines)
+{
+    std::vector<uint8_t> image;
+    add_block(image, "A", 0x0500, {0xaa});
+    write_image(image);
+
+    TapeTap tape(*machine->mos_6522, path);
+    ASSERT_TRUE(tape.init());
+    EXPECT_EQ(Tape::no_event, tape.exec(100));
+
+    tape.motor_on(true);
+    EXPECT_EQ(100, tape.exec(100));
+    EXPECT_EQ(100, tape.exec(90));
+
+    // Edges run a few cycles late, as at the end of an instruction, but the next
+    // edge is still timed from when the previous one was due.
+    EXPECT_EQ(516, tape.exec(100));
+    EXPECT_EQ(724, tape.exec(519));
+    EXPECT_EQ(932, tape.exec(727));
+
+    // Loading an earlier machine state moves the cycle back, edges then continue from there.
+    const uint64_t after_load = tape.exec(200);
+    EXPECT_GT(after_load, 200);
+    EXPECT_LE(after_load, 200 + 416);
+
+    tape.motor_on(false);
+    EXPECT_EQ(Tape::no_event, tape.exec(935));
+}
+
+TEST_F(TapeTest, RecorderDecodesPulses)
+{
+    TapeRecorder recorder;
+    recorder.start_recording(path);
+
+    uint64_t cycle = 1000;
+    auto output_bit = [&](uint8_t bit) {
+        recorder.output_changed(true, cycle);
+        recorder.output_changed(false, cycle + 208);
+        cycle += bit ? 416 : 624;
+    };
+
+    const uint8_t bytes[] = {0x16, 0x24, 0x00, 0xff, 0xa5};
+    for (int i = 0; i < 4; i++) {
+        output_bit(1);
+    }
+    for (uint8_t byte : bytes) {
+        output_bit(0);
+        uint8_t parity = 1;
+        for (int i = 0; i < 8; i++) {
+            output_bit((byte >> i) & 0x01);
+            parity ^= (byte >> i) & 0x01;
+        }
+        output_bit(parity);
+        for (int i = 0; i < 3; i++) {
+            output_bit(1);
+        }
+    }
+    output_bit(1);
+
+    recorder.write_byte(0x42);
+    recorder.stop();
+
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<uint8_t> written{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    EXPECT_EQ((std::vector<uint8_t>{0x16, 0x24, 0x00, 0xff, 0xa5, 0x42}), written);
+}
+
+TEST_F(TapeTest, WavDecodesEdgesWithHysteresis)
+{
+    // 44.1 kHz mono, five periods of 10 high and 10 low samples, with noise near zero.
+    std::vector<int16_t> samples;
+    for (int period = 0; period < 5; period++) {
+        samples.insert(samples.end(), {8000, 8000, 8000, 500, -500, 8000, 8000, 8000, 8000, 8000});
+        samples.insert(samples.end(), {-8000, -8000, -8000, -500, 500, -8000, -8000, -8000, -8000, -8000});
+    }
+
+    const uint32_t data_size = samples.size() * 2;
+    std::vector<uint8_t> image{'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+                               'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0,
+                               0x44, 0xac, 0, 0, 0x88, 0x58, 0x01, 0, 2, 0, 16, 0,
+                               'd', 'a', 't', 'a', uint8_t(data_size), uint8_t(data_size >> 8), 0, 0};
+    for (int16_t sample : samples) {
+        image.push_back(sample & 0xff);
+        image.push_back(sample >> 8);
+    }
+    path.replace_extension(".wav");
+    write_image(image);
+
+    TapeWav tape(*machine->mos_6522, path);
+    ASSERT_TRUE(tape.init());
+    tape.motor_on(true);
+
+    auto& via_state = machine->mos_6522->get_state();
+    std::vector<uint32_t> edge_cycles;
+    bool level = via_state.cb1;
+    for (uint32_t cycle = 0; cycle < 3000; cycle += 2) {
+        tape.exec(cycle);
+        if (via_state.cb1 != level) {
+            level = via_state.cb1;
+            edge_cycles.push_back(cycle);
+        }
+    }
+
+    // Ten samples at 44.1 kHz is 227 cycles at 1 MHz.
+    ASSERT_EQ(10, edge_cycles.size());
+    for (size_t i = 1; i < edge_cycles.size(); i++) {
+        EXPECT_NEAR(227, edge_cycles[i] - edge_cycles[i - 1], 3);
+    }
+}
+
+} // Unittest